@@ -178,6 +178,19 @@ BEGIN_RCPP
     return R_NilValue;
 END_RCPP
 }
+// libgdalcubes_create_image_collection_from_stac
+int libgdalcubes_create_image_collection_from_stac(std::vector<std::string> files, std::string format_file, std::string outfile);
+RcppExport SEXP _gdalcubes_libgdalcubes_create_image_collection_from_stac(SEXP filesSEXP, SEXP format_fileSEXP, SEXP outfileSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::vector<std::string> >::type files(filesSEXP);
+    Rcpp::traits::input_parameter< std::string >::type format_file(format_fileSEXP);
+    Rcpp::traits::input_parameter< std::string >::type outfile(outfileSEXP);
+    rcpp_result_gen = Rcpp::wrap(libgdalcubes_create_image_collection_from_stac(files, format_file, outfile));
+    return rcpp_result_gen;
+END_RCPP
+}
 // libgdalcubes_add_images
 void libgdalcubes_add_images(SEXP pin, std::vector<std::string> files, bool unroll_archives, std::string outfile);
 RcppExport SEXP _gdalcubes_libgdalcubes_add_images(SEXP pinSEXP, SEXP filesSEXP, SEXP unroll_archivesSEXP, SEXP outfileSEXP) {
@@ -191,6 +204,42 @@ BEGIN_RCPP
     return R_NilValue;
 END_RCPP
 }
+// libgdalcubes_add_image_metadata
+void libgdalcubes_add_image_metadata(SEXP pin, std::vector<std::string> names, Rcpp::List attributes);
+RcppExport SEXP _gdalcubes_libgdalcubes_add_image_metadata(SEXP pinSEXP, SEXP namesSEXP, SEXP attributesSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type pin(pinSEXP);
+    Rcpp::traits::input_parameter< std::vector<std::string> >::type names(namesSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type attributes(attributesSEXP);
+    libgdalcubes_add_image_metadata(pin, names, attributes);
+    return R_NilValue;
+END_RCPP
+}
+// libgdalcubes_filter_image_collection
+SEXP libgdalcubes_filter_image_collection(SEXP pin, std::string predicate, std::string outfile);
+RcppExport SEXP _gdalcubes_libgdalcubes_filter_image_collection(SEXP pinSEXP, SEXP predicateSEXP, SEXP outfileSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type pin(pinSEXP);
+    Rcpp::traits::input_parameter< std::string >::type predicate(predicateSEXP);
+    Rcpp::traits::input_parameter< std::string >::type outfile(outfileSEXP);
+    rcpp_result_gen = Rcpp::wrap(libgdalcubes_filter_image_collection(pin, predicate, outfile));
+    return rcpp_result_gen;
+END_RCPP
+}
+// libgdalcubes_image_collection_file
+std::string libgdalcubes_image_collection_file(SEXP pin);
+RcppExport SEXP _gdalcubes_libgdalcubes_image_collection_file(SEXP pinSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type pin(pinSEXP);
+    rcpp_result_gen = Rcpp::wrap(libgdalcubes_image_collection_file(pin));
+    return rcpp_result_gen;
+END_RCPP
+}
 // libgdalcubes_list_collection_formats
 SEXP libgdalcubes_list_collection_formats();
 RcppExport SEXP _gdalcubes_libgdalcubes_list_collection_formats() {
@@ -213,16 +262,17 @@ BEGIN_RCPP
 END_RCPP
 }
 // libgdalcubes_create_image_collection_cube
-SEXP libgdalcubes_create_image_collection_cube(SEXP pin, Rcpp::IntegerVector chunk_sizes, SEXP mask, SEXP v);
-RcppExport SEXP _gdalcubes_libgdalcubes_create_image_collection_cube(SEXP pinSEXP, SEXP chunk_sizesSEXP, SEXP maskSEXP, SEXP vSEXP) {
+SEXP libgdalcubes_create_image_collection_cube(SEXP pin, Rcpp::IntegerVector chunk_sizes, SEXP mask, bool split, SEXP v);
+RcppExport SEXP _gdalcubes_libgdalcubes_create_image_collection_cube(SEXP pinSEXP, SEXP chunk_sizesSEXP, SEXP maskSEXP, SEXP splitSEXP, SEXP vSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< SEXP >::type pin(pinSEXP);
     Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type chunk_sizes(chunk_sizesSEXP);
     Rcpp::traits::input_parameter< SEXP >::type mask(maskSEXP);
+    Rcpp::traits::input_parameter< bool >::type split(splitSEXP);
     Rcpp::traits::input_parameter< SEXP >::type v(vSEXP);
-    rcpp_result_gen = Rcpp::wrap(libgdalcubes_create_image_collection_cube(pin, chunk_sizes, mask, v));
+    rcpp_result_gen = Rcpp::wrap(libgdalcubes_create_image_collection_cube(pin, chunk_sizes, mask, split, v));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -253,15 +303,16 @@ BEGIN_RCPP
 END_RCPP
 }
 // libgdalcubes_create_reduce_time_cube
-SEXP libgdalcubes_create_reduce_time_cube(SEXP pin, std::vector<std::string> reducers, std::vector<std::string> bands);
-RcppExport SEXP _gdalcubes_libgdalcubes_create_reduce_time_cube(SEXP pinSEXP, SEXP reducersSEXP, SEXP bandsSEXP) {
+SEXP libgdalcubes_create_reduce_time_cube(SEXP pin, std::vector<std::string> reducers, std::vector<std::string> bands, uint32_t approx_quantile_compression);
+RcppExport SEXP _gdalcubes_libgdalcubes_create_reduce_time_cube(SEXP pinSEXP, SEXP reducersSEXP, SEXP bandsSEXP, SEXP approx_quantile_compressionSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< SEXP >::type pin(pinSEXP);
     Rcpp::traits::input_parameter< std::vector<std::string> >::type reducers(reducersSEXP);
     Rcpp::traits::input_parameter< std::vector<std::string> >::type bands(bandsSEXP);
-    rcpp_result_gen = Rcpp::wrap(libgdalcubes_create_reduce_time_cube(pin, reducers, bands));
+    Rcpp::traits::input_parameter< uint32_t >::type approx_quantile_compression(approx_quantile_compressionSEXP);
+    rcpp_result_gen = Rcpp::wrap(libgdalcubes_create_reduce_time_cube(pin, reducers, bands, approx_quantile_compression));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -280,15 +331,16 @@ BEGIN_RCPP
 END_RCPP
 }
 // libgdalcubes_create_reduce_space_cube
-SEXP libgdalcubes_create_reduce_space_cube(SEXP pin, std::vector<std::string> reducers, std::vector<std::string> bands);
-RcppExport SEXP _gdalcubes_libgdalcubes_create_reduce_space_cube(SEXP pinSEXP, SEXP reducersSEXP, SEXP bandsSEXP) {
+SEXP libgdalcubes_create_reduce_space_cube(SEXP pin, std::vector<std::string> reducers, std::vector<std::string> bands, uint32_t approx_quantile_compression);
+RcppExport SEXP _gdalcubes_libgdalcubes_create_reduce_space_cube(SEXP pinSEXP, SEXP reducersSEXP, SEXP bandsSEXP, SEXP approx_quantile_compressionSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< SEXP >::type pin(pinSEXP);
     Rcpp::traits::input_parameter< std::vector<std::string> >::type reducers(reducersSEXP);
     Rcpp::traits::input_parameter< std::vector<std::string> >::type bands(bandsSEXP);
-    rcpp_result_gen = Rcpp::wrap(libgdalcubes_create_reduce_space_cube(pin, reducers, bands));
+    Rcpp::traits::input_parameter< uint32_t >::type approx_quantile_compression(approx_quantile_compressionSEXP);
+    rcpp_result_gen = Rcpp::wrap(libgdalcubes_create_reduce_space_cube(pin, reducers, bands, approx_quantile_compression));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -428,6 +480,53 @@ BEGIN_RCPP
     return R_NilValue;
 END_RCPP
 }
+// libgdalcubes_write_zarr
+void libgdalcubes_write_zarr(SEXP pin, std::string dir, uint8_t compression_level, SEXP packing);
+RcppExport SEXP _gdalcubes_libgdalcubes_write_zarr(SEXP pinSEXP, SEXP dirSEXP, SEXP compression_levelSEXP, SEXP packingSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type pin(pinSEXP);
+    Rcpp::traits::input_parameter< std::string >::type dir(dirSEXP);
+    Rcpp::traits::input_parameter< uint8_t >::type compression_level(compression_levelSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type packing(packingSEXP);
+    libgdalcubes_write_zarr(pin, dir, compression_level, packing);
+    return R_NilValue;
+END_RCPP
+}
+// libgdalcubes_write_cube_store
+void libgdalcubes_write_cube_store(SEXP pin, std::string dir);
+RcppExport SEXP _gdalcubes_libgdalcubes_write_cube_store(SEXP pinSEXP, SEXP dirSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type pin(pinSEXP);
+    Rcpp::traits::input_parameter< std::string >::type dir(dirSEXP);
+    libgdalcubes_write_cube_store(pin, dir);
+    return R_NilValue;
+END_RCPP
+}
+// libgdalcubes_update_cube_store
+uint32_t libgdalcubes_update_cube_store(SEXP pin, std::string dir);
+RcppExport SEXP _gdalcubes_libgdalcubes_update_cube_store(SEXP pinSEXP, SEXP dirSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type pin(pinSEXP);
+    Rcpp::traits::input_parameter< std::string >::type dir(dirSEXP);
+    rcpp_result_gen = Rcpp::wrap(libgdalcubes_update_cube_store(pin, dir));
+    return rcpp_result_gen;
+END_RCPP
+}
+// libgdalcubes_open_cube_store
+SEXP libgdalcubes_open_cube_store(std::string dir);
+RcppExport SEXP _gdalcubes_libgdalcubes_open_cube_store(SEXP dirSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type dir(dirSEXP);
+    rcpp_result_gen = Rcpp::wrap(libgdalcubes_open_cube_store(dir));
+    return rcpp_result_gen;
+END_RCPP
+}
 // libgdalcubes_create_stream_cube
 SEXP libgdalcubes_create_stream_cube(SEXP pin, std::string cmd);
 RcppExport SEXP _gdalcubes_libgdalcubes_create_stream_cube(SEXP pinSEXP, SEXP cmdSEXP) {
@@ -453,7 +552,7 @@ BEGIN_RCPP
 END_RCPP
 }
 // libgdalcubes_query_points
-SEXP libgdalcubes_query_points(SEXP pin, std::vector<double> px, std::vector<double> py, std::vector<std::string> pt, std::string srs);
+SEXP libgdalcubes_query_points(SEXP pin, std::vector<double> px, std::vector<double> py, SEXP pt, std::string srs);
 RcppExport SEXP _gdalcubes_libgdalcubes_query_points(SEXP pinSEXP, SEXP pxSEXP, SEXP pySEXP, SEXP ptSEXP, SEXP srsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
@@ -461,12 +560,83 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< SEXP >::type pin(pinSEXP);
     Rcpp::traits::input_parameter< std::vector<double> >::type px(pxSEXP);
     Rcpp::traits::input_parameter< std::vector<double> >::type py(pySEXP);
-    Rcpp::traits::input_parameter< std::vector<std::string> >::type pt(ptSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type pt(ptSEXP);
     Rcpp::traits::input_parameter< std::string >::type srs(srsSEXP);
     rcpp_result_gen = Rcpp::wrap(libgdalcubes_query_points(pin, px, py, pt, srs));
     return rcpp_result_gen;
 END_RCPP
 }
+// libgdalcubes_query_timeseries
+SEXP libgdalcubes_query_timeseries(SEXP pin, std::vector<double> px, std::vector<double> py, std::string srs);
+RcppExport SEXP _gdalcubes_libgdalcubes_query_timeseries(SEXP pinSEXP, SEXP pxSEXP, SEXP pySEXP, SEXP srsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type pin(pinSEXP);
+    Rcpp::traits::input_parameter< std::vector<double> >::type px(pxSEXP);
+    Rcpp::traits::input_parameter< std::vector<double> >::type py(pySEXP);
+    Rcpp::traits::input_parameter< std::string >::type srs(srsSEXP);
+    rcpp_result_gen = Rcpp::wrap(libgdalcubes_query_timeseries(pin, px, py, srs));
+    return rcpp_result_gen;
+END_RCPP
+}
+// libgdalcubes_read_preview
+SEXP libgdalcubes_read_preview(SEXP pin, std::vector<std::string> bands, std::vector<int> t, uint32_t max_nx, uint32_t max_ny);
+RcppExport SEXP _gdalcubes_libgdalcubes_read_preview(SEXP pinSEXP, SEXP bandsSEXP, SEXP tSEXP, SEXP max_nxSEXP, SEXP max_nySEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type pin(pinSEXP);
+    Rcpp::traits::input_parameter< std::vector<std::string> >::type bands(bandsSEXP);
+    Rcpp::traits::input_parameter< std::vector<int> >::type t(tSEXP);
+    Rcpp::traits::input_parameter< uint32_t >::type max_nx(max_nxSEXP);
+    Rcpp::traits::input_parameter< uint32_t >::type max_ny(max_nySEXP);
+    rcpp_result_gen = Rcpp::wrap(libgdalcubes_read_preview(pin, bands, t, max_nx, max_ny));
+    return rcpp_result_gen;
+END_RCPP
+}
+// libgdalcubes_preview
+void libgdalcubes_preview(SEXP pin, std::vector<std::string> bands, std::vector<int> t, std::vector<int> max_nx, std::vector<int> max_ny, Rcpp::Function f);
+RcppExport SEXP _gdalcubes_libgdalcubes_preview(SEXP pinSEXP, SEXP bandsSEXP, SEXP tSEXP, SEXP max_nxSEXP, SEXP max_nySEXP, SEXP fSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type pin(pinSEXP);
+    Rcpp::traits::input_parameter< std::vector<std::string> >::type bands(bandsSEXP);
+    Rcpp::traits::input_parameter< std::vector<int> >::type t(tSEXP);
+    Rcpp::traits::input_parameter< std::vector<int> >::type max_nx(max_nxSEXP);
+    Rcpp::traits::input_parameter< std::vector<int> >::type max_ny(max_nySEXP);
+    Rcpp::traits::input_parameter< Rcpp::Function >::type f(fSEXP);
+    libgdalcubes_preview(pin, bands, t, max_nx, max_ny, f);
+    return R_NilValue;
+END_RCPP
+}
+// libgdalcubes_zonal_statistics
+SEXP libgdalcubes_zonal_statistics(SEXP pin, std::vector<std::string> wkt, std::string srs, std::vector<std::string> reducers, std::vector<std::string> bands, uint32_t approx_quantile_compression);
+RcppExport SEXP _gdalcubes_libgdalcubes_zonal_statistics(SEXP pinSEXP, SEXP wktSEXP, SEXP srsSEXP, SEXP reducersSEXP, SEXP bandsSEXP, SEXP approx_quantile_compressionSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type pin(pinSEXP);
+    Rcpp::traits::input_parameter< std::vector<std::string> >::type wkt(wktSEXP);
+    Rcpp::traits::input_parameter< std::string >::type srs(srsSEXP);
+    Rcpp::traits::input_parameter< std::vector<std::string> >::type reducers(reducersSEXP);
+    Rcpp::traits::input_parameter< std::vector<std::string> >::type bands(bandsSEXP);
+    Rcpp::traits::input_parameter< uint32_t >::type approx_quantile_compression(approx_quantile_compressionSEXP);
+    rcpp_result_gen = Rcpp::wrap(libgdalcubes_zonal_statistics(pin, wkt, srs, reducers, bands, approx_quantile_compression));
+    return rcpp_result_gen;
+END_RCPP
+}
+// libgdalcubes_mask_statistics
+Rcpp::List libgdalcubes_mask_statistics(bool reset);
+RcppExport SEXP _gdalcubes_libgdalcubes_mask_statistics(SEXP resetSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< bool >::type reset(resetSEXP);
+    rcpp_result_gen = Rcpp::wrap(libgdalcubes_mask_statistics(reset));
+    return rcpp_result_gen;
+END_RCPP
+}
 // libgdalcubes_set_threads
 void libgdalcubes_set_threads(IntegerVector n);
 RcppExport SEXP _gdalcubes_libgdalcubes_set_threads(SEXP nSEXP) {
@@ -516,15 +686,19 @@ static const R_CallMethodDef CallEntries[] = {
     {"_gdalcubes_libgdalcubes_image_collection_info", (DL_FUNC) &_gdalcubes_libgdalcubes_image_collection_info, 1},
     {"_gdalcubes_libgdalcubes_image_collection_extent", (DL_FUNC) &_gdalcubes_libgdalcubes_image_collection_extent, 2},
     {"_gdalcubes_libgdalcubes_create_image_collection", (DL_FUNC) &_gdalcubes_libgdalcubes_create_image_collection, 4},
+    {"_gdalcubes_libgdalcubes_create_image_collection_from_stac", (DL_FUNC) &_gdalcubes_libgdalcubes_create_image_collection_from_stac, 3},
     {"_gdalcubes_libgdalcubes_add_images", (DL_FUNC) &_gdalcubes_libgdalcubes_add_images, 4},
+    {"_gdalcubes_libgdalcubes_add_image_metadata", (DL_FUNC) &_gdalcubes_libgdalcubes_add_image_metadata, 3},
+    {"_gdalcubes_libgdalcubes_filter_image_collection", (DL_FUNC) &_gdalcubes_libgdalcubes_filter_image_collection, 3},
+    {"_gdalcubes_libgdalcubes_image_collection_file", (DL_FUNC) &_gdalcubes_libgdalcubes_image_collection_file, 1},
     {"_gdalcubes_libgdalcubes_list_collection_formats", (DL_FUNC) &_gdalcubes_libgdalcubes_list_collection_formats, 0},
     {"_gdalcubes_libgdalcubes_create_view", (DL_FUNC) &_gdalcubes_libgdalcubes_create_view, 1},
-    {"_gdalcubes_libgdalcubes_create_image_collection_cube", (DL_FUNC) &_gdalcubes_libgdalcubes_create_image_collection_cube, 4},
+    {"_gdalcubes_libgdalcubes_create_image_collection_cube", (DL_FUNC) &_gdalcubes_libgdalcubes_create_image_collection_cube, 5},
     {"_gdalcubes_libgdalcubes_create_dummy_cube", (DL_FUNC) &_gdalcubes_libgdalcubes_create_dummy_cube, 4},
     {"_gdalcubes_libgdalcubes_create_reduce_cube", (DL_FUNC) &_gdalcubes_libgdalcubes_create_reduce_cube, 2},
-    {"_gdalcubes_libgdalcubes_create_reduce_time_cube", (DL_FUNC) &_gdalcubes_libgdalcubes_create_reduce_time_cube, 3},
+    {"_gdalcubes_libgdalcubes_create_reduce_time_cube", (DL_FUNC) &_gdalcubes_libgdalcubes_create_reduce_time_cube, 4},
     {"_gdalcubes_libgdalcubes_create_stream_reduce_time_cube", (DL_FUNC) &_gdalcubes_libgdalcubes_create_stream_reduce_time_cube, 4},
-    {"_gdalcubes_libgdalcubes_create_reduce_space_cube", (DL_FUNC) &_gdalcubes_libgdalcubes_create_reduce_space_cube, 3},
+    {"_gdalcubes_libgdalcubes_create_reduce_space_cube", (DL_FUNC) &_gdalcubes_libgdalcubes_create_reduce_space_cube, 4},
     {"_gdalcubes_libgdalcubes_create_window_time_cube_reduce", (DL_FUNC) &_gdalcubes_libgdalcubes_create_window_time_cube_reduce, 4},
     {"_gdalcubes_libgdalcubes_create_window_time_cube_kernel", (DL_FUNC) &_gdalcubes_libgdalcubes_create_window_time_cube_kernel, 3},
     {"_gdalcubes_libgdalcubes_create_join_bands_cube", (DL_FUNC) &_gdalcubes_libgdalcubes_create_join_bands_cube, 4},
@@ -535,9 +709,18 @@ static const R_CallMethodDef CallEntries[] = {
     {"_gdalcubes_libgdalcubes_debug_output", (DL_FUNC) &_gdalcubes_libgdalcubes_debug_output, 1},
     {"_gdalcubes_libgdalcubes_eval_cube", (DL_FUNC) &_gdalcubes_libgdalcubes_eval_cube, 6},
     {"_gdalcubes_libgdalcubes_write_tif", (DL_FUNC) &_gdalcubes_libgdalcubes_write_tif, 8},
+    {"_gdalcubes_libgdalcubes_write_zarr", (DL_FUNC) &_gdalcubes_libgdalcubes_write_zarr, 4},
+    {"_gdalcubes_libgdalcubes_write_cube_store", (DL_FUNC) &_gdalcubes_libgdalcubes_write_cube_store, 2},
+    {"_gdalcubes_libgdalcubes_update_cube_store", (DL_FUNC) &_gdalcubes_libgdalcubes_update_cube_store, 2},
+    {"_gdalcubes_libgdalcubes_open_cube_store", (DL_FUNC) &_gdalcubes_libgdalcubes_open_cube_store, 1},
     {"_gdalcubes_libgdalcubes_create_stream_cube", (DL_FUNC) &_gdalcubes_libgdalcubes_create_stream_cube, 2},
     {"_gdalcubes_libgdalcubes_create_fill_time_cube", (DL_FUNC) &_gdalcubes_libgdalcubes_create_fill_time_cube, 2},
     {"_gdalcubes_libgdalcubes_query_points", (DL_FUNC) &_gdalcubes_libgdalcubes_query_points, 5},
+    {"_gdalcubes_libgdalcubes_query_timeseries", (DL_FUNC) &_gdalcubes_libgdalcubes_query_timeseries, 4},
+    {"_gdalcubes_libgdalcubes_read_preview", (DL_FUNC) &_gdalcubes_libgdalcubes_read_preview, 5},
+    {"_gdalcubes_libgdalcubes_preview", (DL_FUNC) &_gdalcubes_libgdalcubes_preview, 6},
+    {"_gdalcubes_libgdalcubes_zonal_statistics", (DL_FUNC) &_gdalcubes_libgdalcubes_zonal_statistics, 6},
+    {"_gdalcubes_libgdalcubes_mask_statistics", (DL_FUNC) &_gdalcubes_libgdalcubes_mask_statistics, 1},
     {"_gdalcubes_libgdalcubes_set_threads", (DL_FUNC) &_gdalcubes_libgdalcubes_set_threads, 1},
     {"_gdalcubes_libgdalcubes_set_swarm", (DL_FUNC) &_gdalcubes_libgdalcubes_set_swarm, 1},
     {"_gdalcubes_libgdalcubes_simple_hash", (DL_FUNC) &_gdalcubes_libgdalcubes_simple_hash, 1},
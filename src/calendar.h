@@ -0,0 +1,50 @@
+
+#ifndef CALENDAR_H
+#define CALENDAR_H
+
+#include <cstdint>
+
+namespace gdalcubes {
+
+namespace calendar {
+
+/**
+ * @brief Days since 1970-01-01 of a date in the proleptic Gregorian calendar
+ * @param y year
+ * @param m month, 1 to 12
+ * @param d day of month, 1 to 31
+ * @return number of days, negative for dates before 1970-01-01
+ */
+inline int64_t days_from_civil(int64_t y, int64_t m, int64_t d) {
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    int64_t yoe = y - era * 400;
+    int64_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+/**
+ * @brief Date of a number of days since 1970-01-01, inverse of days_from_civil()
+ * @param z number of days
+ * @param y year
+ * @param m month, 1 to 12
+ * @param d day of month, 1 to 31
+ */
+inline void civil_from_days(int64_t z, int64_t &y, int64_t &m, int64_t &d) {
+    z += 719468;
+    int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    int64_t doe = z - era * 146097;
+    int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int64_t mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp + (mp < 10 ? 3 : -9);
+    y = yoe + era * 400 + (m <= 2);
+}
+
+}  // namespace calendar
+
+}  // namespace gdalcubes
+
+#endif  //CALENDAR_H
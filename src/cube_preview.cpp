@@ -0,0 +1,188 @@
+
+#include "cube_preview.h"
+
+#include "parallel_for.h"
+
+#include <algorithm>
+#include <cmath>
+#include <future>
+
+namespace gdalcubes {
+
+bool cube_preview::scale_views(nlohmann::json &j, double f) {
+    bool changed = false;
+    if (j.is_object()) {
+        if (j.count("cube_type") && j.count("view") && j["view"].is_object() && j["view"].count("space")) {
+            nlohmann::json &space = j["view"]["space"];
+            uint32_t nx = std::max(1.0, std::round(space["nx"].get<double>() / f));
+            uint32_t ny = std::max(1.0, std::round(space["ny"].get<double>() / f));
+            space["nx"] = nx;
+            space["ny"] = ny;
+            if (space.count("dx")) {
+                space["dx"] = (space["right"].get<double>() - space["left"].get<double>()) / nx;
+            }
+            if (space.count("dy")) {
+                space["dy"] = (space["top"].get<double>() - space["bottom"].get<double>()) / ny;
+            }
+            changed = true;
+        }
+        for (auto it = j.begin(); it != j.end(); ++it) {
+            changed = scale_views(it.value(), f) || changed;
+        }
+    } else if (j.is_array()) {
+        for (uint32_t i = 0; i < j.size(); ++i) {
+            changed = scale_views(j[i], f) || changed;
+        }
+    }
+    return changed;
+}
+
+std::shared_ptr<cube> cube_preview::prepare(std::shared_ptr<cube> c, std::vector<std::string> bands, uint32_t max_nx, uint32_t max_ny) {
+    std::shared_ptr<cube> out = c;
+    double f = std::max(double(c->st_reference()->nx()) / double(std::max(uint32_t(1), max_nx)),
+                        double(c->st_reference()->ny()) / double(std::max(uint32_t(1), max_ny)));
+    if (f > 1) {
+        nlohmann::json j = c->make_constructible_json();
+        if (scale_views(j, f)) {
+            try {
+                out = cube_factory::instance()->create_from_json(j);
+            } catch (...) {
+                GCBS_DEBUG("Cannot reduce the resolution of the data cube graph, values will be sampled from full resolution");
+                out = c;
+            }
+        }
+    }
+    if (!bands.empty()) {
+        for (uint16_t i = 0; i < bands.size(); ++i) {
+            if (!out->bands().has(bands[i])) {
+                throw std::string("ERROR in cube_preview::prepare(): Data cube has no band '" + bands[i] + "'");
+            }
+        }
+        out = select_bands_cube::create(out, bands);
+    }
+    return out;
+}
+
+std::vector<double> cube_preview::read(std::shared_ptr<cube> c, std::vector<uint32_t> t, uint32_t nx, uint32_t ny,
+                                       std::shared_ptr<progress> prg, std::shared_ptr<chunk_processor> p) {
+    auto st = c->st_reference();
+    uint32_t nb = c->bands().count();
+    uint64_t nt_out = t.size();
+
+    // position of cube time slices in the output, -1 if not requested
+    std::vector<int32_t> tpos(st->nt(), -1);
+    for (uint32_t i = 0; i < t.size(); ++i) {
+        if (t[i] >= st->nt()) {
+            throw std::string("ERROR in cube_preview::read(): Time index " + std::to_string(t[i]) + " is out of range");
+        }
+        tpos[t[i]] = i;
+    }
+
+    // nearest neighbor sampling, monotonic such that chunk ranges can be found by binary search
+    nx = std::min(nx, st->nx());
+    ny = std::min(ny, st->ny());
+    std::vector<uint32_t> col_of(nx), row_of(ny);
+    for (uint32_t i = 0; i < nx; ++i) {
+        col_of[i] = std::min(st->nx() - 1, uint32_t((i + 0.5) * st->nx() / nx));
+    }
+    for (uint32_t i = 0; i < ny; ++i) {
+        row_of[i] = std::min(st->ny() - 1, uint32_t((i + 0.5) * st->ny() / ny));
+    }
+
+    std::vector<chunkid_t> chunks;
+    uint32_t nchunks_xy = c->count_chunks_x() * c->count_chunks_y();
+    for (uint32_t ct = 0; ct < c->count_chunks_t(); ++ct) {
+        uint32_t t0 = ct * c->chunk_size()[0];
+        uint32_t t1 = std::min(st->nt(), t0 + c->chunk_size()[0]);
+        bool needed = false;
+        for (uint32_t it = t0; it < t1 && !needed; ++it) {
+            needed = tpos[it] >= 0;
+        }
+        if (!needed) continue;
+        for (uint32_t cxy = 0; cxy < nchunks_xy; ++cxy) {
+            chunks.push_back(ct * nchunks_xy + cxy);
+        }
+    }
+
+    std::vector<double> out(uint64_t(nb) * nt_out * ny * nx, NAN);
+
+    if (!prg) {
+        prg = config::instance()->get_default_progress_bar()->get();
+    }
+    prg->set(0);
+
+    parallel_for(chunks.size(), [&](uint32_t k) {
+        std::shared_ptr<chunk_data> dat = c->read_chunk(chunks[k]);
+        prg->increment(1.0 / double(chunks.size()));
+        if (dat->empty()) return;
+
+        bounds_nd<uint32_t, 3> lim = c->chunk_limits(chunks[k]);
+        uint32_t csize_t = dat->size()[1], csize_y = dat->size()[2], csize_x = dat->size()[3];
+        uint32_t ox0 = std::lower_bound(col_of.begin(), col_of.end(), lim.low[2]) - col_of.begin();
+        uint32_t ox1 = std::lower_bound(col_of.begin(), col_of.end(), lim.low[2] + csize_x) - col_of.begin();
+        uint32_t oy0 = std::lower_bound(row_of.begin(), row_of.end(), lim.low[1]) - row_of.begin();
+        uint32_t oy1 = std::lower_bound(row_of.begin(), row_of.end(), lim.low[1] + csize_y) - row_of.begin();
+
+        for (uint32_t ib = 0; ib < nb; ++ib) {
+            for (uint32_t it = 0; it < csize_t; ++it) {
+                int32_t ot = tpos[lim.low[0] + it];
+                if (ot < 0) continue;
+                const double *src = ((double *)dat->buf()) + (uint64_t(ib) * csize_t + it) * csize_y * csize_x;
+                for (uint32_t oy = oy0; oy < oy1; ++oy) {
+                    const double *src_row = src + uint64_t(row_of[oy] - lim.low[1]) * csize_x;
+                    double *dst = out.data() + ((uint64_t(ib) * nt_out + ot) * ny + oy) * nx;
+                    for (uint32_t ox = ox0; ox < ox1; ++ox) {
+                        dst[ox] = src_row[col_of[ox] - lim.low[2]];
+                    }
+                }
+            }
+        }
+    }, p);
+    prg->finalize();
+    return out;
+}
+
+void cube_preview::progressive(std::shared_ptr<cube> c, std::vector<std::string> bands, std::vector<uint32_t> t,
+                               std::vector<uint32_t> max_nx, std::vector<uint32_t> max_ny,
+                               std::function<void(uint32_t, std::vector<double> &, uint32_t, uint32_t)> f) {
+    if (max_nx.size() != max_ny.size()) {
+        throw std::string("ERROR in cube_preview::progressive(): Expected the same number of levels in x and y direction");
+    }
+    struct level_result {
+        std::vector<double> values;
+        uint32_t nx;
+        uint32_t ny;
+    };
+    auto compute = [c, &bands, &t, &max_nx, &max_ny](uint32_t level, std::shared_ptr<progress> prg, std::shared_ptr<chunk_processor> p) -> level_result {
+        std::shared_ptr<cube> lc = prepare(c, bands, max_nx[level], max_ny[level]);
+        level_result r;
+        r.nx = std::min(max_nx[level], lc->st_reference()->nx());
+        r.ny = std::min(max_ny[level], lc->st_reference()->ny());
+        r.values = read(lc, t, r.nx, r.ny, prg, p);
+        return r;
+    };
+
+    if (max_nx.empty()) return;
+    // the default chunk processor may check for user interrupts and hence must only be used by the calling thread
+    std::shared_ptr<chunk_processor> p_background = std::make_shared<chunk_processor_multithread>(
+        std::max(uint32_t(1), config::instance()->get_default_chunk_processor()->max_threads()));
+    level_result current = compute(0, nullptr, nullptr);
+    for (uint32_t level = 0; level < max_nx.size(); ++level) {
+        std::future<level_result> next;
+        if (level + 1 < max_nx.size()) {
+            // background levels must not report progress, the progress bar belongs to the calling thread
+            next = std::async(std::launch::async, compute, level + 1, std::make_shared<progress_none>(), p_background);
+        }
+        try {
+            f(level, current.values, current.nx, current.ny);
+        } catch (...) {
+            if (next.valid()) next.wait();
+            throw;
+        }
+        if (next.valid()) {
+            current = next.get();
+        }
+    }
+}
+
+}  // namespace gdalcubes
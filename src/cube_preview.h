@@ -0,0 +1,79 @@
+
+#ifndef CUBE_PREVIEW_H
+#define CUBE_PREVIEW_H
+
+#include "gdalcubes/src/gdalcubes.h"
+
+#include <functional>
+
+namespace gdalcubes {
+
+/**
+ * @brief Evaluate selected bands and time slices of a data cube at reduced spatial resolution, e.g. for plots
+ *
+ * Instead of writing the complete data cube to a file, only chunks that contain requested time slices are computed
+ * and copied to a single in-memory array. The band selection and the reduced resolution are pushed down to the
+ * data cube graph, i.e. image collection cubes read and warp images directly at the target resolution.
+ */
+class cube_preview {
+   public:
+    /**
+     * @brief Create a data cube with selected bands and a spatial size not larger than the given maximum
+     *
+     * The constructible JSON description of c is modified such that all cube views of source cubes use
+     * a proportionally reduced number of pixels, keeping the spatial extent. If the graph cannot be
+     * recreated, values are sampled from the original resolution in read().
+     *
+     * @param c input data cube
+     * @param bands names of bands to keep, all bands if empty
+     * @param max_nx maximum number of pixels in x direction
+     * @param max_ny maximum number of pixels in y direction
+     * @return data cube to be passed to read()
+     */
+    static std::shared_ptr<cube> prepare(std::shared_ptr<cube> c, std::vector<std::string> bands, uint32_t max_nx, uint32_t max_ny);
+
+    /**
+     * @brief Read selected time slices of a data cube into a single array
+     *
+     * Chunks are computed in parallel by the given chunk processor. Chunks without any of the requested time
+     * slices are not computed.
+     *
+     * @param c data cube
+     * @param t zero-based time indexes
+     * @param nx number of pixels of the result in x direction, pixels are sampled by nearest neighbor if smaller than the cube
+     * @param ny number of pixels of the result in y direction
+     * @param prg progress bar, if nullptr, the default progress bar will be used
+     * @param p chunk processor, if nullptr, the default chunk processor will be used
+     * @return values with x varying fastest, followed by y, time (in the order of t), and band
+     */
+    static std::vector<double> read(std::shared_ptr<cube> c, std::vector<uint32_t> t, uint32_t nx, uint32_t ny,
+                                    std::shared_ptr<progress> prg = nullptr, std::shared_ptr<chunk_processor> p = nullptr);
+
+    /**
+     * @brief Evaluate a data cube progressively at increasing spatial resolutions
+     *
+     * Levels are evaluated one after another with prepare() and read(). While the callback processes the result of one
+     * level in the calling thread, the next level is already computed by background threads, i.e. the callback
+     * may run long-lasting operations such as plotting without delaying refinement. Only the first level reports
+     * progress and can be interrupted, later levels are computed with a multithreaded chunk processor with the
+     * same number of threads as the default chunk processor. If the callback throws, the computation of the next level is finished before the exception is
+     * passed to the caller.
+     *
+     * @param c input data cube
+     * @param bands names of bands to keep, all bands if empty
+     * @param t zero-based time indexes
+     * @param max_nx maximum number of pixels in x direction per level, typically increasing
+     * @param max_ny maximum number of pixels in y direction per level, same length as max_nx
+     * @param f callback receiving the level index, the values as returned by read(), and the size in x and y direction
+     */
+    static void progressive(std::shared_ptr<cube> c, std::vector<std::string> bands, std::vector<uint32_t> t,
+                            std::vector<uint32_t> max_nx, std::vector<uint32_t> max_ny,
+                            std::function<void(uint32_t, std::vector<double> &, uint32_t, uint32_t)> f);
+
+   protected:
+    static bool scale_views(nlohmann::json &j, double f);
+};
+
+}  // namespace gdalcubes
+
+#endif  //CUBE_PREVIEW_H
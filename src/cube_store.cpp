@@ -0,0 +1,381 @@
+
+#include "cube_store.h"
+
+#include "image_metadata.h"
+#include "kernels.h"
+#include "parallel_for.h"
+#include "point_queries.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <set>
+
+namespace gdalcubes {
+
+namespace {
+
+// chunk files start with this magic number followed by four uint32 sizes (band, time, y, x)
+const char chunk_magic[8] = {'G', 'C', 'B', 'S', 'C', 'H', 'K', '1'};
+const uint32_t chunk_header_size = 8 + 4 * sizeof(uint32_t);
+
+// operations computing each output value from the same time slice / spatial pixel of their inputs
+const std::set<std::string> time_local_types = {"image_collection", "select_bands", "apply_pixel", "filter_pixel", "join_bands",
+                                                "reduce_space", "reduce_space_incremental", "cube_store"};
+const std::set<std::string> space_local_types = {"image_collection", "select_bands", "apply_pixel", "filter_pixel", "join_bands",
+                                                 "reduce_time", "reduce_time_incremental", "window_time", "window_time_sliding",
+                                                 "fill_time", "fill_time_streaming", "cube_store"};
+
+}  // namespace
+
+cube_store_cube::cube_store_cube(std::string dir) : cube_store_cube(dir, read_header(dir)) {}
+
+cube_store_cube::cube_store_cube(std::string dir, nlohmann::json header) : cube(st_reference_from_header(header)), _dir(dir), _header(header) {
+    _chunk_size[0] = header["chunk_size"][0].get<uint32_t>();
+    _chunk_size[1] = header["chunk_size"][1].get<uint32_t>();
+    _chunk_size[2] = header["chunk_size"][2].get<uint32_t>();
+
+    for (uint16_t i = 0; i < header["bands"].size(); ++i) {
+        band b(header["bands"][i]["name"].get<std::string>());
+        b.offset = header["bands"][i]["offset"].get<double>();
+        b.scale = header["bands"][i]["scale"].get<double>();
+        b.unit = header["bands"][i]["unit"].get<std::string>();
+        _bands.add(b);
+    }
+}
+
+nlohmann::json cube_store_cube::read_header(std::string dir) {
+    std::string fname = filesystem::join(dir, "cube.json");
+    if (!filesystem::exists(fname)) {
+        throw std::string("ERROR in cube_store_cube::read_header(): '" + dir + "' is not a complete cube store");
+    }
+    std::ifstream f(fname);
+    nlohmann::json header;
+    try {
+        f >> header;
+    } catch (...) {
+        throw std::string("ERROR in cube_store_cube::read_header(): invalid cube store header '" + fname + "'");
+    }
+    if (header["format_version"].get<int>() != 1) {
+        throw std::string("ERROR in cube_store_cube::read_header(): unsupported cube store version");
+    }
+    return header;
+}
+
+std::shared_ptr<cube_st_reference> cube_store_cube::st_reference_from_header(nlohmann::json &header) {
+    std::shared_ptr<cube_view> v = std::make_shared<cube_view>();
+    nlohmann::json &space = header["view"]["space"];
+    nlohmann::json &time = header["view"]["time"];
+    v->left() = space["left"].get<double>();
+    v->right() = space["right"].get<double>();
+    v->top() = space["top"].get<double>();
+    v->bottom() = space["bottom"].get<double>();
+    v->nx() = space["nx"].get<uint32_t>();
+    v->ny() = space["ny"].get<uint32_t>();
+    v->srs() = space["srs"].get<std::string>();
+    v->t0() = datetime::from_string(time["t0"].get<std::string>());
+    v->t1() = datetime::from_string(time["t1"].get<std::string>());
+    v->dt(duration::from_string(time["dt"].get<std::string>()));
+    v->t0().unit() = v->dt().dt_unit;
+    v->t1().unit() = v->dt().dt_unit;
+    return v;
+}
+
+std::string cube_store_cube::chunk_file(std::string dir, chunkid_t id) {
+    return filesystem::join(dir, std::to_string(id) + ".chunk");
+}
+
+std::shared_ptr<chunk_data> cube_store_cube::read_chunk(chunkid_t id) {
+    GCBS_TRACE("cube_store_cube::read_chunk(" + std::to_string(id) + ")");
+    std::shared_ptr<chunk_data> out = std::make_shared<chunk_data>();
+    if (id < 0 || id >= count_chunks())
+        return out;  // chunk is outside of the view, we don't need to read anything.
+
+    std::string fname = chunk_file(_dir, id);
+    if (!filesystem::exists(fname)) {
+        return out;  // empty chunks are not stored
+    }
+    std::ifstream f(fname, std::ios::in | std::ios::binary);
+    char magic[8];
+    uint32_t size[4];
+    f.read(magic, 8);
+    f.read((char *)size, 4 * sizeof(uint32_t));
+    if (!f || std::memcmp(magic, chunk_magic, 8) != 0) {
+        GCBS_ERROR("Invalid chunk file '" + fname + "'");
+        return out;
+    }
+    coords_nd<uint32_t, 3> size_tyx = chunk_size(id);
+    if (size[0] != _bands.count() || size[1] != size_tyx[0] || size[2] != size_tyx[1] || size[3] != size_tyx[2]) {
+        GCBS_ERROR("Chunk file '" + fname + "' does not match the chunk size of the cube store");
+        return out;
+    }
+    coords_nd<uint32_t, 4> size_btyx = {size[0], size[1], size[2], size[3]};
+    uint64_t nbytes = uint64_t(size[0]) * uint64_t(size[1]) * uint64_t(size[2]) * uint64_t(size[3]) * sizeof(double);
+    out->size(size_btyx);
+    out->buf(std::malloc(nbytes));
+    // values are stored exactly as in memory, a single read without any decoding
+    f.read((char *)out->buf(), nbytes);
+    if (!f) {
+        GCBS_ERROR("Failed to read chunk file '" + fname + "'");
+        return std::make_shared<chunk_data>();
+    }
+    return out;
+}
+
+void cube_store_cube::write(std::shared_ptr<cube> c, std::string dir, std::shared_ptr<chunk_processor> p,
+                            std::vector<std::pair<double, double>> *range) {
+    if (!p) {
+        p = config::instance()->get_default_chunk_processor();
+    }
+    if (!filesystem::exists(dir)) {
+        filesystem::mkdir_recursive(dir);
+    }
+    if (!filesystem::is_directory(dir)) {
+        throw std::string("ERROR in cube_store_cube::write(): invalid output directory.");
+    }
+
+    std::shared_ptr<progress> prg = config::instance()->get_default_progress_bar()->get();
+    prg->set(0);
+
+    if (range) {
+        range->assign(c->bands().count(), std::make_pair(std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest()));
+    }
+
+    // chunk processors log and skip chunks that fail to compute or to write, only chunks counted here are complete
+    std::atomic<uint32_t> nwritten(0);
+    std::function<void(chunkid_t, std::shared_ptr<chunk_data>, std::mutex &)> f = [c, dir, range, prg, &nwritten](chunkid_t id, std::shared_ptr<chunk_data> dat, std::mutex &m) {
+        if (!dat->empty()) {
+            if (range) {
+                uint64_t nband = uint64_t(dat->size()[1]) * uint64_t(dat->size()[2]) * uint64_t(dat->size()[3]);
+                std::vector<std::pair<double, double>> r(dat->size()[0], std::make_pair(std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest()));
+                for (uint16_t i = 0; i < dat->size()[0]; ++i) {
+                    kernels::minmax((double *)dat->buf() + i * nband, nband, r[i].first, r[i].second);
+                }
+                m.lock();
+                for (uint16_t i = 0; i < r.size(); ++i) {
+                    (*range)[i].first = std::min((*range)[i].first, r[i].first);
+                    (*range)[i].second = std::max((*range)[i].second, r[i].second);
+                }
+                m.unlock();
+            }
+            write_chunk(dir, id, dat);
+        }
+        ++nwritten;
+        prg->increment((double)1 / (double)c->count_chunks());
+    };
+    p->apply(c, f);
+    prg->finalize();
+    if (nwritten != c->count_chunks()) {
+        throw std::string("ERROR in cube_store_cube::write(): " + std::to_string(c->count_chunks() - nwritten) + " chunk(s) failed or have been skipped, the cube store is incomplete");
+    }
+    write_header(c, dir);
+}
+
+void cube_store_cube::write_chunk(std::string dir, chunkid_t id, std::shared_ptr<chunk_data> dat) {
+    uint32_t size[4] = {dat->size()[0], dat->size()[1], dat->size()[2], dat->size()[3]};
+    uint64_t nbytes = uint64_t(size[0]) * uint64_t(size[1]) * uint64_t(size[2]) * uint64_t(size[3]) * sizeof(double);
+    std::string fname = chunk_file(dir, id);
+    std::ofstream out(fname, std::ios::out | std::ios::binary | std::ios::trunc);
+    out.write(chunk_magic, 8);
+    out.write((const char *)size, 4 * sizeof(uint32_t));
+    out.write((const char *)dat->buf(), nbytes);
+    out.close();
+    if (!out) {
+        // a partially written file would be read as an invalid chunk
+        std::remove(fname.c_str());
+        throw std::string("ERROR in cube_store_cube::write_chunk(): failed to write chunk file '" + fname + "'");
+    }
+}
+
+void cube_store_cube::write_header(std::shared_ptr<cube> c, std::string dir) {
+    auto st = c->st_reference();
+    nlohmann::json header;
+    header["format_version"] = 1;
+    header["view"]["space"] = {{"left", st->left()}, {"right", st->right()}, {"top", st->top()}, {"bottom", st->bottom()},
+                               {"nx", st->nx()}, {"ny", st->ny()}, {"srs", st->srs()}};
+    header["view"]["time"] = {{"t0", st->t0().to_string()}, {"t1", st->t1().to_string()}, {"dt", st->dt().to_string()}};
+    header["chunk_size"] = {c->chunk_size()[0], c->chunk_size()[1], c->chunk_size()[2]};
+    header["bands"] = nlohmann::json::array();
+    for (uint16_t i = 0; i < c->bands().count(); ++i) {
+        band b = c->bands().get(i);
+        header["bands"].push_back({{"name", b.name}, {"offset", b.offset}, {"scale", b.scale}, {"unit", b.unit}});
+    }
+    header["source"] = c->make_constructible_json();
+
+    // insertion epochs of source image collections in the order of their appearance in the data cube graph
+    std::vector<std::string> files;
+    bool time_local = true, space_local = true;
+    find_collections(header["source"], files, time_local, space_local);
+    header["epochs"] = nlohmann::json::array();
+    try {
+        for (uint16_t i = 0; i < files.size(); ++i) {
+            header["epochs"].push_back(image_metadata::epoch(std::make_shared<image_collection>(files[i])));
+        }
+    } catch (...) {
+        GCBS_WARN("Cannot read insertion epochs of source image collections, the cube store cannot be updated incrementally");
+        header.erase("epochs");
+    }
+
+    // replace the header at once, such that updated stores cannot be opened with an incomplete header
+    std::string fname = filesystem::join(dir, "cube.json");
+    std::ofstream fheader(fname + ".tmp");
+    fheader << header.dump(2);
+    fheader.close();
+    if (std::rename((fname + ".tmp").c_str(), fname.c_str()) != 0) {
+        // rename does not replace existing files on Windows
+        std::remove(fname.c_str());
+        std::rename((fname + ".tmp").c_str(), fname.c_str());
+    }
+}
+
+void cube_store_cube::find_collections(nlohmann::json &j, std::vector<std::string> &files, bool &time_local, bool &space_local) {
+    if (j.is_object()) {
+        if (j.count("cube_type")) {
+            std::string type = j["cube_type"].get<std::string>();
+            time_local = time_local && time_local_types.count(type) > 0;
+            space_local = space_local && space_local_types.count(type) > 0;
+            if (type == "image_collection" && j.count("file")) {
+                files.push_back(j["file"].get<std::string>());
+            }
+        }
+        for (auto it = j.begin(); it != j.end(); ++it) {
+            find_collections(it.value(), files, time_local, space_local);
+        }
+    } else if (j.is_array()) {
+        for (uint32_t i = 0; i < j.size(); ++i) {
+            find_collections(j[i], files, time_local, space_local);
+        }
+    }
+}
+
+uint32_t cube_store_cube::update(std::shared_ptr<cube> c, std::string dir, std::shared_ptr<chunk_processor> p) {
+    nlohmann::json header = read_header(dir);
+    std::shared_ptr<cube_store_cube> stored = create(dir);
+    auto st = c->st_reference();
+    auto st_stored = stored->st_reference();
+    bool compatible = st->nx() == st_stored->nx() && st->ny() == st_stored->ny() && st->nt() == st_stored->nt() &&
+                      st->left() == st_stored->left() && st->top() == st_stored->top() && st->dx() == st_stored->dx() &&
+                      st->dy() == st_stored->dy() && st->t0().to_string() == st_stored->t0().to_string() && st->dt().to_string() == st_stored->dt().to_string() &&
+                      c->chunk_size()[0] == stored->chunk_size()[0] && c->chunk_size()[1] == stored->chunk_size()[1] &&
+                      c->chunk_size()[2] == stored->chunk_size()[2] && c->bands().count() == stored->bands().count();
+    for (uint16_t i = 0; compatible && i < c->bands().count(); ++i) {
+        compatible = c->bands().get(i).name == stored->bands().get(i).name;
+    }
+    if (!compatible) {
+        throw std::string("ERROR in cube_store_cube::update(): Data cube does not match the shape, chunk size, or bands of the cube store");
+    }
+
+    nlohmann::json source = c->make_constructible_json();
+    std::vector<std::string> files;
+    bool time_local = true, space_local = true;
+    find_collections(source, files, time_local, space_local);
+
+    std::vector<bool> affected(c->count_chunks(), false);
+    if (!header.count("epochs") || header["epochs"].size() != files.size()) {
+        GCBS_WARN("Cube store has no matching image collection epochs, all chunks will be recomputed");
+        std::fill(affected.begin(), affected.end(), true);
+    } else {
+        uint32_t ncx = c->count_chunks_x(), ncy = c->count_chunks_y(), nct = c->count_chunks_t();
+        for (uint16_t k = 0; k < files.size(); ++k) {
+            std::vector<image_metadata::footprint> fp = image_metadata::added_since(std::make_shared<image_collection>(files[k]),
+                                                                                     header["epochs"][k].get<uint32_t>());
+            std::vector<std::string> dt;
+            for (uint32_t i = 0; i < fp.size(); ++i) {
+                dt.push_back(fp[i].datetime);
+            }
+            std::vector<double> secs = point_queries::epoch_seconds(dt);
+            std::vector<int32_t> it = point_queries::cell_t(c, secs);
+            for (uint32_t i = 0; i < fp.size(); ++i) {
+                uint32_t ct0 = 0, ct1 = nct - 1;
+                if (time_local) {
+                    if (it[i] < 0) continue;  // image is outside of the cube's time range
+                    ct0 = ct1 = it[i] / c->chunk_size()[0];
+                }
+                uint32_t cx0 = 0, cx1 = ncx - 1, cy0 = 0, cy1 = ncy - 1;
+                if (space_local) {
+                    bounds_2d<double> b;
+                    b.left = fp[i].left;
+                    b.right = fp[i].right;
+                    b.bottom = fp[i].bottom;
+                    b.top = fp[i].top;
+                    b = b.transform("EPSG:4326", st->srs().c_str());
+                    double col0 = std::floor((b.left - st->left()) / st->dx());
+                    double col1 = std::floor((b.right - st->left()) / st->dx());
+                    double row0 = std::floor((st->top() - b.top) / st->dy());
+                    double row1 = std::floor((st->top() - b.bottom) / st->dy());
+                    if (col1 < 0 || row1 < 0 || col0 >= st->nx() || row0 >= st->ny()) continue;  // no spatial overlap
+                    cx0 = uint32_t(std::max(0.0, col0)) / c->chunk_size()[2];
+                    cx1 = uint32_t(std::min(double(st->nx() - 1), col1)) / c->chunk_size()[2];
+                    cy0 = uint32_t(std::max(0.0, row0)) / c->chunk_size()[1];
+                    cy1 = uint32_t(std::min(double(st->ny() - 1), row1)) / c->chunk_size()[1];
+                }
+                for (uint32_t ct = ct0; ct <= ct1; ++ct) {
+                    for (uint32_t cy = cy0; cy <= cy1; ++cy) {
+                        for (uint32_t cx = cx0; cx <= cx1; ++cx) {
+                            affected[(uint64_t(ct) * ncy + cy) * ncx + cx] = true;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    std::vector<chunkid_t> chunks;
+    for (chunkid_t id = 0; id < affected.size(); ++id) {
+        if (affected[id]) chunks.push_back(id);
+    }
+    GCBS_DEBUG("Recomputing " + std::to_string(chunks.size()) + " of " + std::to_string(c->count_chunks()) + " chunks of cube store '" + dir + "'");
+
+    std::shared_ptr<progress> prg = config::instance()->get_default_progress_bar()->get();
+    prg->set(0);
+    std::atomic<uint32_t> nrecomputed(0);
+    parallel_for(chunks.size(), [&](uint32_t k) {
+        std::shared_ptr<chunk_data> dat = c->read_chunk(chunks[k]);
+        if (dat->empty()) {
+            std::remove(chunk_file(dir, chunks[k]).c_str());
+        } else {
+            write_chunk(dir, chunks[k], dat);
+        }
+        ++nrecomputed;
+        prg->increment(1.0 / double(chunks.size()));
+    }, p);
+    prg->finalize();
+    // epochs are only updated if all chunks have been recomputed successfully, failed chunks throw in parallel_for()
+    // but interrupted loops simply skip the remaining chunks
+    if (nrecomputed != chunks.size()) {
+        throw std::string("ERROR in cube_store_cube::update(): computation has been interrupted, affected chunks will be recomputed by the next update");
+    }
+    write_header(c, dir);
+    return chunks.size();
+}
+
+void cube_store_cube::remove(std::string dir, chunkid_t count_chunks) {
+    if (!filesystem::is_directory(dir)) {
+        return;
+    }
+    std::shared_ptr<cube_store_cube> c = nullptr;
+    try {
+        c = create(dir);
+    } catch (...) {
+    }
+    if (c) {
+        count_chunks = c->count_chunks();
+    }
+    for (chunkid_t id = 0; id < count_chunks; ++id) {
+        std::remove(chunk_file(dir, id).c_str());
+    }
+    std::remove(filesystem::join(dir, "cube.json").c_str());
+    std::remove(dir.c_str());
+}
+
+void cube_store_cube::register_cube_type() {
+    cube_factory::instance()->register_cube_type("cube_store", [](nlohmann::json& j) {
+        return cube_store_cube::create(j["dir"].get<std::string>());
+    });
+}
+
+}  // namespace gdalcubes
@@ -0,0 +1,119 @@
+
+#ifndef CUBE_STORE_H
+#define CUBE_STORE_H
+
+#include "gdalcubes/src/gdalcubes.h"
+
+namespace gdalcubes {
+
+/**
+ * @brief A data cube that reads chunks from a chunk-native cube store on disk
+ *
+ * A cube store is a directory with one binary file per non-empty chunk and a JSON header (cube.json) describing the
+ * spatiotemporal reference, bands, and chunk size of the stored cube together with the constructible JSON description
+ * of the cube it has been created from. Chunk files contain a small fixed-size header followed by the raw
+ * chunk buffer (doubles in native byte order, order band, time, y, x), i.e. they can be memory-mapped and
+ * chunks are read without any decoding or reprojection. Chunks of the store cube are identical to the chunks
+ * of the written cube.
+ */
+class cube_store_cube : public cube {
+   public:
+    /**
+     * @brief Open a cube store as a data cube
+     * @param dir directory of the cube store
+     * @return a shared pointer to the created data cube instance
+     */
+    static std::shared_ptr<cube_store_cube> create(std::string dir) {
+        return std::make_shared<cube_store_cube>(dir);
+    }
+
+    /**
+     * @brief Evaluate a data cube and write all of its chunks to a new cube store
+     *
+     * Chunks are written as independent files by the worker threads of the chunk processor, without any lock.
+     * The header file is written last, i.e. incomplete stores cannot be opened. If any chunk fails to compute or to write,
+     * or if the computation is interrupted, no header is written and an exception is thrown.
+     *
+     * @param c data cube
+     * @param dir output directory
+     * @param p chunk processor, if nullptr, the default chunk processor will be used
+     * @param range if not nullptr, receives the minimum and maximum of non-NaN values per band
+     */
+    static void write(std::shared_ptr<cube> c, std::string dir, std::shared_ptr<chunk_processor> p = nullptr,
+                      std::vector<std::pair<double, double>> *range = nullptr);
+
+    /**
+     * @brief Recompute chunks of an existing cube store that are affected by images added to source image collections
+     *
+     * The header of a cube store records the insertion epoch (see image_metadata::epoch()) of all image collections
+     * referenced by the written cube. Chunks are recomputed if they intersect with the spatial footprint of images added
+     * afterwards and, if all operations of the data cube graph are independent per time slice, contain the time slice of
+     * an added image. Operations that combine values over time or space extend the affected chunks along the combined
+     * dimension. All other chunks are kept. If the store has no recorded epochs, all chunks are recomputed.
+     * Recorded epochs are only updated if all affected chunks have been written, otherwise an exception is thrown and
+     * the next update recomputes the same chunks.
+     *
+     * @param c data cube, must have the same shape, chunk size, and bands as the stored cube
+     * @param dir directory of an existing cube store
+     * @param p chunk processor recomputing the affected chunks, if nullptr, the default chunk processor will be used
+     * @return number of recomputed chunks
+     */
+    static uint32_t update(std::shared_ptr<cube> c, std::string dir, std::shared_ptr<chunk_processor> p = nullptr);
+
+    /**
+     * @brief Delete a cube store including its directory
+     * @param dir directory of the cube store
+     * @param count_chunks number of chunk files to delete if the store has no readable cube.json, e.g. because write()
+     * has been interrupted
+     */
+    static void remove(std::string dir, chunkid_t count_chunks = 0);
+
+   public:
+    cube_store_cube(std::string dir);
+
+   private:
+    cube_store_cube(std::string dir, nlohmann::json header);
+
+   public:
+    ~cube_store_cube() {}
+
+    std::shared_ptr<chunk_data> read_chunk(chunkid_t id) override;
+
+    nlohmann::json make_constructible_json() override {
+        nlohmann::json out;
+        out["cube_type"] = "cube_store";
+        out["dir"] = _dir;
+        return out;
+    }
+
+    /**
+     * @brief Constructible JSON description of the cube this store has been created from
+     */
+    nlohmann::json source_json() {
+        return _header["source"];
+    }
+
+    /**
+     * @brief Register this cube type at the cube factory, such that it can be recreated from its JSON description
+     */
+    static void register_cube_type();
+
+   private:
+    std::string _dir;
+    nlohmann::json _header;
+
+    static nlohmann::json read_header(std::string dir);
+    static std::shared_ptr<cube_st_reference> st_reference_from_header(nlohmann::json &header);
+    static std::string chunk_file(std::string dir, chunkid_t id);
+    static void write_chunk(std::string dir, chunkid_t id, std::shared_ptr<chunk_data> dat);
+    static void write_header(std::shared_ptr<cube> c, std::string dir);
+    static void find_collections(nlohmann::json &j, std::vector<std::string> &files, bool &time_local, bool &space_local);
+
+    void set_st_reference(std::shared_ptr<cube_st_reference> stref) override {
+        throw std::string("ERROR in cube_store_cube::set_st_reference(): The spatiotemporal reference of stored data cubes cannot be changed");
+    }
+};
+
+}  // namespace gdalcubes
+
+#endif  //CUBE_STORE_H
@@ -0,0 +1,190 @@
+
+#include "fill_time_streaming.h"
+
+#include "kernels.h"
+
+#include <cstdlib>
+
+namespace gdalcubes {
+
+fill_time_streaming_cube::fill_time_streaming_cube(std::shared_ptr<cube> in, std::string method) : cube(std::make_shared<cube_st_reference>(*(in->st_reference()))), _in_cube(in), _method(method) {
+    _chunk_size[0] = _in_cube->chunk_size()[0];
+    _chunk_size[1] = _in_cube->chunk_size()[1];
+    _chunk_size[2] = _in_cube->chunk_size()[2];
+
+    if (!supports(method)) {
+        throw std::string("ERROR in fill_time_streaming_cube::fill_time_streaming_cube(): Unknown interpolation method given");
+    }
+    for (uint16_t i = 0; i < in->bands().count(); ++i) {
+        _bands.add(in->bands().get(i));
+    }
+}
+
+std::shared_ptr<chunk_data> fill_time_streaming_cube::read_chunk(chunkid_t id) {
+    GCBS_TRACE("fill_time_streaming_cube::read_chunk(" + std::to_string(id) + ")");
+    std::shared_ptr<chunk_data> out = std::make_shared<chunk_data>();
+    if (id < 0 || id >= count_chunks())
+        return out;  // chunk is outside of the view, we don't need to read anything.
+
+    coords_nd<uint32_t, 3> size_tyx = chunk_size(id);
+    coords_nd<uint32_t, 4> size_btyx = {uint32_t(_bands.count()), size_tyx[0], size_tyx[1], size_tyx[2]};
+    uint16_t nb = _bands.count();
+    int32_t nt = size_tyx[0];
+    uint64_t np = uint64_t(size_tyx[1]) * uint64_t(size_tyx[2]);
+
+    uint32_t nchunks_xy = count_chunks_x() * count_chunks_y();
+    int32_t ct = id / nchunks_xy;
+    int32_t t_first = ct * _chunk_size[0];
+
+    bool need_prev = (_method != "nocb");
+    bool need_next = (_method != "locf");
+
+    // boundary state per band and pixel: last valid value / time before and next valid value / time after this chunk
+    std::vector<double> prev_v, prev_t, next_v, next_t;
+    boundary_state(id % nchunks_xy, ct, prev_v, prev_t, next_v, next_t);
+
+    std::shared_ptr<chunk_data> in = _in_cube->read_chunk(id);
+    std::vector<double> empty;
+    if (in->empty()) {
+        empty.resize(uint64_t(nb) * uint64_t(nt) * np, NAN);
+    }
+    const double *in_buf = in->empty() ? empty.data() : (double *)in->buf();
+
+    out->size(size_btyx);
+    out->buf(std::malloc(size_btyx[0] * size_btyx[1] * size_btyx[2] * size_btyx[3] * sizeof(double)));
+
+    uint64_t nband = uint64_t(nt) * np;
+    std::vector<double> fwd_v, fwd_t, bwd_v, bwd_t;
+    if (need_prev && need_next) {
+        fwd_v.resize(nband);
+        fwd_t.resize(nband);
+        bwd_v.resize(nband);
+        bwd_t.resize(nband);
+    }
+    for (uint16_t ib = 0; ib < nb; ++ib) {
+        const double *src = in_buf + ib * nband;
+        double *dst = ((double *)out->buf()) + ib * nband;
+        if (_method == "locf") {
+            kernels::fill_scan_forward(src, nt, np, t_first, prev_v.data() + ib * np, prev_t.data() + ib * np, dst, NULL);
+            continue;
+        }
+        if (_method == "nocb") {
+            kernels::fill_scan_backward(src, nt, np, t_first, next_v.data() + ib * np, next_t.data() + ib * np, dst, NULL);
+            continue;
+        }
+        kernels::fill_scan_forward(src, nt, np, t_first, prev_v.data() + ib * np, prev_t.data() + ib * np, fwd_v.data(), fwd_t.data());
+        kernels::fill_scan_backward(src, nt, np, t_first, next_v.data() + ib * np, next_t.data() + ib * np, bwd_v.data(), bwd_t.data());
+        for (int32_t t = 0; t < nt; ++t) {
+            double tg = t_first + t;
+            for (uint64_t p = 0; p < np; ++p) {
+                uint64_t i = uint64_t(t) * np + p;
+                double v;
+                if (std::isnan(fwd_t[i])) {
+                    v = (_method == "near") ? bwd_v[i] : NAN;
+                } else if (std::isnan(bwd_t[i])) {
+                    v = (_method == "near") ? fwd_v[i] : NAN;
+                } else if (fwd_t[i] == bwd_t[i]) {
+                    v = fwd_v[i];
+                } else if (_method == "near") {
+                    v = (tg - fwd_t[i] <= bwd_t[i] - tg) ? fwd_v[i] : bwd_v[i];
+                } else {
+                    v = fwd_v[i] + (bwd_v[i] - fwd_v[i]) * (tg - fwd_t[i]) / (bwd_t[i] - fwd_t[i]);
+                }
+                dst[i] = v;
+            }
+        }
+    }
+    return out;
+}
+
+void fill_time_streaming_cube::boundary_state(uint32_t cxy, uint32_t ct, std::vector<double> &prev_v, std::vector<double> &prev_t,
+                                              std::vector<double> &next_v, std::vector<double> &next_t) {
+    std::shared_ptr<column_state> col;
+    {
+        std::lock_guard<std::mutex> lock(_m_columns);
+        std::shared_ptr<column_state> &c = _columns[cxy];
+        if (!c) c = std::make_shared<column_state>();
+        col = c;
+    }
+
+    uint16_t nb = _bands.count();
+    coords_nd<uint32_t, 3> size_tyx = chunk_size(cxy);
+    uint64_t np = uint64_t(size_tyx[1]) * uint64_t(size_tyx[2]);
+    uint64_t nbp = uint64_t(nb) * np;
+    uint32_t nchunks_xy = count_chunks_x() * count_chunks_y();
+    uint32_t nchunks_t = count_chunks_t();
+    bool need_prev = (_method != "nocb");
+    bool need_next = (_method != "locf");
+
+    std::lock_guard<std::mutex> lock(col->m);
+    if (!col->ready) {
+        // one forward pass over all time chunks: prev_* receives the running state before each chunk, next_* the first
+        // valid value within each chunk, which is then turned into the state after each chunk by a backward pass
+        if (need_prev) {
+            col->prev_v.assign(nchunks_t * nbp, NAN);
+            col->prev_t.assign(nchunks_t * nbp, NAN);
+        }
+        if (need_next) {
+            col->next_v.assign(nchunks_t * nbp, NAN);
+            col->next_t.assign(nchunks_t * nbp, NAN);
+        }
+        std::vector<double> run_v(nbp, NAN), run_t(nbp, NAN);
+        for (uint32_t ci = 0; ci < nchunks_t; ++ci) {
+            if (need_prev) {
+                std::copy(run_v.begin(), run_v.end(), col->prev_v.begin() + ci * nbp);
+                std::copy(run_t.begin(), run_t.end(), col->prev_t.begin() + ci * nbp);
+            }
+            std::shared_ptr<chunk_data> x = _in_cube->read_chunk(ci * nchunks_xy + cxy);
+            if (x->empty()) continue;
+            for (uint16_t ib = 0; ib < nb; ++ib) {
+                const double *src = ((double *)x->buf()) + uint64_t(ib) * x->size()[1] * np;
+                if (need_prev) {
+                    kernels::fill_scan_forward(src, x->size()[1], np, ci * _chunk_size[0], run_v.data() + ib * np, run_t.data() + ib * np, NULL, NULL);
+                }
+                if (need_next) {
+                    kernels::fill_scan_backward(src, x->size()[1], np, ci * _chunk_size[0], col->next_v.data() + ci * nbp + ib * np, col->next_t.data() + ci * nbp + ib * np, NULL, NULL);
+                }
+            }
+        }
+        if (need_next) {
+            std::fill(run_v.begin(), run_v.end(), NAN);
+            std::fill(run_t.begin(), run_t.end(), NAN);
+            for (int32_t ci = int32_t(nchunks_t) - 1; ci >= 0; --ci) {
+                double *first_v = col->next_v.data() + ci * nbp;
+                double *first_t = col->next_t.data() + ci * nbp;
+                for (uint64_t i = 0; i < nbp; ++i) {
+                    double v = first_v[i], t = first_t[i];
+                    first_v[i] = run_v[i];
+                    first_t[i] = run_t[i];
+                    if (!std::isnan(t)) {
+                        run_v[i] = v;
+                        run_t[i] = t;
+                    }
+                }
+            }
+        }
+        col->ready = true;
+    }
+
+    if (need_prev) {
+        prev_v.assign(col->prev_v.begin() + ct * nbp, col->prev_v.begin() + (ct + 1) * nbp);
+        prev_t.assign(col->prev_t.begin() + ct * nbp, col->prev_t.begin() + (ct + 1) * nbp);
+    }
+    if (need_next) {
+        next_v.assign(col->next_v.begin() + ct * nbp, col->next_v.begin() + (ct + 1) * nbp);
+        next_t.assign(col->next_t.begin() + ct * nbp, col->next_t.begin() + (ct + 1) * nbp);
+    }
+    if (++col->consumed == nchunks_t) {
+        // all time chunks of the column have been filled
+        std::lock_guard<std::mutex> lock_columns(_m_columns);
+        _columns.erase(cxy);
+    }
+}
+
+void fill_time_streaming_cube::register_cube_type() {
+    cube_factory::instance()->register_cube_type("fill_time_streaming", [](nlohmann::json& j) {
+        return fill_time_streaming_cube::create(cube_factory::instance()->create_from_json(j["in_cube"]), j["method"].get<std::string>());
+    });
+}
+
+}  // namespace gdalcubes
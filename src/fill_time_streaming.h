@@ -0,0 +1,106 @@
+
+#ifndef FILL_TIME_STREAMING_H
+#define FILL_TIME_STREAMING_H
+
+#include "gdalcubes/src/gdalcubes.h"
+
+#include <map>
+#include <mutex>
+
+namespace gdalcubes {
+
+/**
+ * @brief A data cube that fills NA values by time series interpolation, chunk by chunk
+ *
+ * In contrast to fill_time_cube, complete pixel time series are never loaded at once. Each output chunk is filled from
+ * its own input chunk and a boundary state holding the last valid value before and the next valid value after
+ * the chunk per pixel. When the first chunk of a spatial chunk column is requested, the boundary states of all time chunks
+ * of the column are computed in a single pass that reads each input chunk once and only keeps the first and last valid
+ * value of each chunk per pixel. Boundary states are released when all time chunks of the column have been read.
+ * Results are identical to fill_time_cube and do not depend on the chunk size.
+ *
+ * All computations process all pixels of a time slice at once.
+ */
+class fill_time_streaming_cube : public cube {
+   public:
+    /**
+     * @brief Create a data cube that fills NA values by time series interpolation
+     * @note This static creation method should preferably be used instead of the constructors as
+     * the constructors will not set connections between cubes properly.
+     * @param in input data cube
+     * @param method interpolation method, one of "near", "linear", "locf", "nocb"
+     * @return a shared pointer to the created data cube instance
+     */
+    static std::shared_ptr<fill_time_streaming_cube> create(std::shared_ptr<cube> in, std::string method = "near") {
+        std::shared_ptr<fill_time_streaming_cube> out = std::make_shared<fill_time_streaming_cube>(in, method);
+        in->add_child_cube(out);
+        out->add_parent_cube(in);
+        return out;
+    }
+
+    /**
+     * @brief Check whether an interpolation method is supported
+     */
+    static bool supports(std::string method) {
+        return method == "near" || method == "linear" || method == "locf" || method == "nocb";
+    }
+
+   public:
+    fill_time_streaming_cube(std::shared_ptr<cube> in, std::string method = "near");
+
+   public:
+    ~fill_time_streaming_cube() {}
+
+    std::shared_ptr<chunk_data> read_chunk(chunkid_t id) override;
+
+    nlohmann::json make_constructible_json() override {
+        nlohmann::json out;
+        out["cube_type"] = "fill_time_streaming";
+        out["method"] = _method;
+        out["in_cube"] = _in_cube->make_constructible_json();
+        return out;
+    }
+
+    /**
+     * @brief Register this cube type at the cube factory, such that it can be recreated from its JSON description
+     */
+    static void register_cube_type();
+
+   private:
+    std::shared_ptr<cube> _in_cube;
+    std::string _method;
+
+    // boundary states of all time chunks of a spatial chunk column, indexed by time chunk, band, and pixel
+    struct column_state {
+        column_state() : ready(false), consumed(0) {}
+        std::mutex m;
+        bool ready;
+        uint32_t consumed;
+        std::vector<double> prev_v, prev_t, next_v, next_t;
+    };
+    std::mutex _m_columns;
+    std::map<uint32_t, std::shared_ptr<column_state>> _columns;
+
+    /**
+     * @brief Get the last valid values before and the next valid values after a chunk
+     * @param cxy spatial index of the chunk
+     * @param ct temporal index of the chunk
+     * @param prev_v, prev_t, next_v, next_t output values and time indexes per band and pixel, NAN if there is no valid value
+     */
+    void boundary_state(uint32_t cxy, uint32_t ct, std::vector<double> &prev_v, std::vector<double> &prev_t,
+                        std::vector<double> &next_v, std::vector<double> &next_t);
+
+    void set_st_reference(std::shared_ptr<cube_st_reference> stref) override {
+        _st_ref->win() = stref->win();
+        _st_ref->srs() = stref->srs();
+        _st_ref->ny() = stref->ny();
+        _st_ref->nx() = stref->nx();
+        _st_ref->t0() = stref->t0();
+        _st_ref->t1() = stref->t1();
+        _st_ref->dt(stref->dt());
+    }
+};
+
+}  // namespace gdalcubes
+
+#endif  //FILL_TIME_STREAMING_H
@@ -1,5 +1,17 @@
 
 #include "gdalcubes/src/gdalcubes.h"
+#include "typed_export.h"
+#include "reduce_time_incremental.h"
+#include "reduce_space_incremental.h"
+#include "window_time_sliding.h"
+#include "fill_time_streaming.h"
+#include "point_queries.h"
+#include "zonal_statistics.h"
+#include "cube_store.h"
+#include "cube_preview.h"
+#include "lut_mask.h"
+#include "image_metadata.h"
+#include "stac_import.h"
 
 // [[Rcpp::plugins("cpp11")]]
 // [[Rcpp::depends(RcppProgress)]]
@@ -9,11 +21,70 @@
 #include <memory>
 #include <thread>
 #include <algorithm>
+#include <map>
 
 
 using namespace Rcpp;
 using namespace gdalcubes;
 
+/**
+ * @brief Convert an R packing definition with integer type to packing parameters
+ * 
+ * Offset and scale are missing for automatic packing, in which case tmpdir must be given.
+ */
+gdalcubes::packing packing_from_list(Rcpp::List pl) {
+  gdalcubes::packing pk;
+  if (pl.containsElementNamed("offset") && !Rf_isNull(pl["offset"])) {
+    pk.offset = Rcpp::as<std::vector<double>>(pl["offset"]);
+  }
+  if (pl.containsElementNamed("scale") && !Rf_isNull(pl["scale"])) {
+    pk.scale = Rcpp::as<std::vector<double>>(pl["scale"]);
+  }
+  if (pl.containsElementNamed("nodata") && !Rf_isNull(pl["nodata"])) {
+    pk.nodata = Rcpp::as<std::vector<double>>(pl["nodata"]);
+  }
+  if (pl.containsElementNamed("tmpdir") && !Rf_isNull(pl["tmpdir"])) {
+    pk.tmpdir = Rcpp::as<std::string>(pl["tmpdir"]);
+  }
+  if (!pk.is_auto() && pk.nodata.empty()) {
+    throw std::string("ERROR in packing_from_list(): missing nodata value(s) for packed export");
+  }
+  return pk;
+}
+
+/**
+ * @brief Reduce the spatial chunk size of a data cube until there is at least one chunk per thread
+ * 
+ * Images are read, warped, and aggregated per chunk, i.e. a cube with fewer chunks than threads cannot use all threads 
+ * for reading. Spatial chunk sizes are halved (larger dimension first) but not below min_size pixels.
+ */
+void split_chunks_for_threads(std::shared_ptr<cube> c, uint32_t min_size = 128) {
+  uint32_t nthreads = config::instance()->get_default_chunk_processor()->max_threads();
+  uint32_t ct = c->chunk_size()[0];
+  uint32_t cy = std::min(c->chunk_size()[1], c->st_reference()->ny());
+  uint32_t cx = std::min(c->chunk_size()[2], c->st_reference()->nx());
+  bool changed = false;
+  while (c->count_chunks() < nthreads) {
+    if (cy >= cx && cy / 2 >= min_size) {
+      cy = (cy + 1) / 2;
+    }
+    else if (cx / 2 >= min_size) {
+      cx = (cx + 1) / 2;
+    }
+    else if (cy / 2 >= min_size) {
+      cy = (cy + 1) / 2;
+    }
+    else {
+      break;
+    }
+    c->set_chunk_size(ct, cy, cx);
+    changed = true;
+  }
+  if (changed) {
+    GCBS_DEBUG("Spatial chunk size reduced to " + std::to_string(cy) + "x" + std::to_string(cx) + " to read images with " + std::to_string(nthreads) + " threads");
+  }
+}
+
 
 
 /**
@@ -113,6 +184,7 @@ struct error_handling_r {
   static std::mutex _m_errhandl;
   static std::stringstream _err_stream;
   static bool _defer;
+  static bool _hold;
   
   static void defer_output() {
     _m_errhandl.lock();
@@ -122,12 +194,33 @@ struct error_handling_r {
   
   static void do_output() {
     _m_errhandl.lock();
-    _defer = false;
+    _defer = _hold;
     Rcpp::Rcerr << _err_stream.str() << std::endl;
     _err_stream.str(""); 
     _m_errhandl.unlock();
   }
   
+  /**
+   * Keep deferring output until released, e.g. while threads are running in the background between calls to flush_output().
+   * do_output() then only prints the messages collected so far. Must only be called from the main thread.
+   */
+  static void hold_output(bool hold) {
+    _m_errhandl.lock();
+    _hold = hold;
+    _defer = hold;
+    _m_errhandl.unlock();
+  }
+  
+  /**
+   * Print deferred messages without changing whether output is deferred. Must only be called from the main thread.
+   */
+  static void flush_output() {
+    _m_errhandl.lock();
+    Rcpp::Rcerr << _err_stream.str();
+    _err_stream.str(""); 
+    _m_errhandl.unlock();
+  }
+  
   static void debug(error_level type, std::string msg, std::string where, int error_code) {
     _m_errhandl.lock();
     std::string code = (error_code != 0) ? " (" + std::to_string(error_code) + ")" : "";
@@ -169,6 +262,7 @@ struct error_handling_r {
 std::mutex error_handling_r::_m_errhandl;
 std::stringstream error_handling_r::_err_stream;
 bool error_handling_r::_defer = false;
+bool error_handling_r::_hold = false;
 
 
 
@@ -272,6 +366,12 @@ void libgdalcubes_init() {
   // Interruptible chunk processor
   config::instance()->set_default_chunk_processor(std::dynamic_pointer_cast<chunk_processor>(std::make_shared<chunk_processor_multithread_interruptible>(1)));
   
+  // cube types implemented in this package
+  reduce_time_incremental_cube::register_cube_type();
+  reduce_space_incremental_cube::register_cube_type();
+  window_time_sliding_cube::register_cube_type();
+  fill_time_streaming_cube::register_cube_type();
+  cube_store_cube::register_cube_type();
 }
 
 // [[Rcpp::export]]
@@ -623,6 +723,34 @@ Rcpp::List libgdalcubes_image_collection_info( SEXP pin) {
                               Rcpp::Named("datetime")=images_datetime,
                               Rcpp::Named("srs")=images_proj);
     
+    // additional image attributes, numeric columns unless any value of an attribute is a string
+    std::vector<image_metadata::md_row> md = image_metadata::get(ic);
+    std::map<uint32_t, uint32_t> row_of_image;
+    for (uint32_t i=0; i<img.size(); ++i) {
+      row_of_image[img[i].id] = i;
+    }
+    std::map<std::string, std::vector<image_metadata::md_row>> md_by_key;
+    for (uint32_t i=0; i<md.size(); ++i) {
+      md_by_key[md[i].key].push_back(md[i]);
+    }
+    for (auto it = md_by_key.begin(); it != md_by_key.end(); ++it) {
+      bool numeric = std::all_of(it->second.begin(), it->second.end(), [](const image_metadata::md_row &r) {return r.numeric;});
+      if (numeric) {
+        Rcpp::NumericVector col(img.size(), NA_REAL);
+        for (uint32_t i=0; i<it->second.size(); ++i) {
+          if (row_of_image.count(it->second[i].image_id)) col[row_of_image[it->second[i].image_id]] = it->second[i].num;
+        }
+        images_df.push_back(col, it->first);
+      }
+      else {
+        Rcpp::CharacterVector col(img.size(), NA_STRING);
+        for (uint32_t i=0; i<it->second.size(); ++i) {
+          if (row_of_image.count(it->second[i].image_id)) col[row_of_image[it->second[i].image_id]] = it->second[i].str;
+        }
+        images_df.push_back(col, it->first);
+      }
+    }
+    
     
     
     
@@ -736,6 +864,18 @@ void libgdalcubes_create_image_collection(std::vector<std::string> files, std::s
   }
 }
 
+// [[Rcpp::export]]
+int libgdalcubes_create_image_collection_from_stac(std::vector<std::string> files, std::string format_file, std::string outfile) {
+  
+  try {
+    collection_format cfmt(format_file);
+    return stac_import::create(cfmt, files, outfile);
+  }
+  catch (std::string s) {
+    Rcpp::stop(s);
+  }
+}
+
 // [[Rcpp::export]]
 void libgdalcubes_add_images(SEXP pin, std::vector<std::string> files, bool unroll_archives=true, std::string outfile = "") {
   
@@ -747,13 +887,56 @@ void libgdalcubes_add_images(SEXP pin, std::vector<std::string> files, bool unro
     if (unroll_archives) {
       files = image_collection::unroll_archives(files);
     }
+    uint32_t last_id = image_metadata::max_image_id(*aa);
     (*aa)->add(files);
+    image_metadata::mark_added(*aa, last_id);
+  }
+  catch (std::string s) {
+    Rcpp::stop(s);
+  }
+}
+
+// [[Rcpp::export]]
+void libgdalcubes_add_image_metadata(SEXP pin, std::vector<std::string> names, Rcpp::List attributes) {
+  
+  try {
+    Rcpp::XPtr<std::shared_ptr<image_collection>> aa = Rcpp::as<Rcpp::XPtr<std::shared_ptr<image_collection>>>(pin);
+    Rcpp::CharacterVector keys = attributes.names();
+    for (uint16_t i=0; i<attributes.size(); ++i) {
+      std::string key = Rcpp::as<std::string>(keys[i]);
+      if (Rf_isNumeric(attributes[i]) || Rf_isLogical(attributes[i])) {
+        image_metadata::put(*aa, names, key, Rcpp::as<std::vector<double>>(attributes[i]));
+      }
+      else {
+        image_metadata::put(*aa, names, key, Rcpp::as<std::vector<std::string>>(attributes[i]));
+      }
+    }
+  }
+  catch (std::string s) {
+    Rcpp::stop(s);
+  }
+}
+
+// [[Rcpp::export]]
+SEXP libgdalcubes_filter_image_collection(SEXP pin, std::string predicate, std::string outfile) {
+  
+  try {
+    Rcpp::XPtr<std::shared_ptr<image_collection>> aa = Rcpp::as<Rcpp::XPtr<std::shared_ptr<image_collection>>>(pin);
+    std::shared_ptr<image_collection>* x = new std::shared_ptr<image_collection>(image_metadata::filter(*aa, predicate, outfile));
+    Rcpp::XPtr< std::shared_ptr<image_collection> > p(x, true) ;
+    return p;
   }
   catch (std::string s) {
     Rcpp::stop(s);
   }
 }
 
+// [[Rcpp::export]]
+std::string libgdalcubes_image_collection_file(SEXP pin) {
+  Rcpp::XPtr<std::shared_ptr<image_collection>> aa = Rcpp::as<Rcpp::XPtr<std::shared_ptr<image_collection>>>(pin);
+  return (*aa)->get_filename();
+}
+
 // [[Rcpp::export]]
 SEXP libgdalcubes_list_collection_formats() {
   try {
@@ -870,7 +1053,7 @@ SEXP libgdalcubes_create_view(SEXP v) {
 
 
 // [[Rcpp::export]]
-SEXP libgdalcubes_create_image_collection_cube(SEXP pin, Rcpp::IntegerVector chunk_sizes, SEXP mask, SEXP v = R_NilValue) {
+SEXP libgdalcubes_create_image_collection_cube(SEXP pin, Rcpp::IntegerVector chunk_sizes, SEXP mask, bool split, SEXP v = R_NilValue) {
 
   try {
     Rcpp::XPtr<std::shared_ptr<image_collection>> aa = Rcpp::as<Rcpp::XPtr<std::shared_ptr<image_collection>>>(pin);
@@ -937,7 +1120,9 @@ SEXP libgdalcubes_create_image_collection_cube(SEXP pin, Rcpp::IntegerVector chu
       x = new std::shared_ptr<image_collection_cube>( image_collection_cube::create(*aa, cv));
     }
     (*x)->set_chunk_size(chunk_sizes[0], chunk_sizes[1], chunk_sizes[2]);
-    
+    if (split) {
+      split_chunks_for_threads(*x);
+    }
     
     if (mask != R_NilValue) {
       std::string band_name = Rcpp::as<Rcpp::List>(mask)["band"]; 
@@ -948,7 +1133,7 @@ SEXP libgdalcubes_create_image_collection_cube(SEXP pin, Rcpp::IntegerVector chu
         std::vector<uint8_t> bits;
         if (Rcpp::as<Rcpp::List>(mask)["bits"] != R_NilValue)
           bits =  Rcpp::as<std::vector<uint8_t>>(Rcpp::as<Rcpp::List>(mask)["bits"]);
-        (*x)->set_mask(band_name, std::make_shared<value_mask>(std::unordered_set<double>(values.begin(), values.end()), invert, bits));
+        (*x)->set_mask(band_name, lut_mask::from_values(std::unordered_set<double>(values.begin(), values.end()), invert, bits));
       }
       else {
         double min = Rcpp::as<Rcpp::List>(mask)["min"];
@@ -956,7 +1141,7 @@ SEXP libgdalcubes_create_image_collection_cube(SEXP pin, Rcpp::IntegerVector chu
         std::vector<uint8_t> bits;
         if (Rcpp::as<Rcpp::List>(mask)["bits"] != R_NilValue)
           bits =  Rcpp::as<std::vector<uint8_t>>(Rcpp::as<Rcpp::List>(mask)["bits"]);
-        (*x)->set_mask(band_name, std::make_shared<range_mask>(min, max, invert, bits));
+        (*x)->set_mask(band_name, lut_mask::from_range(min, max, invert, bits));
       }
     }
     
@@ -1085,7 +1270,7 @@ SEXP libgdalcubes_create_reduce_cube(SEXP pin, std::string reducer) {
 
 
 // [[Rcpp::export]]
-SEXP libgdalcubes_create_reduce_time_cube(SEXP pin, std::vector<std::string> reducers, std::vector<std::string> bands) {
+SEXP libgdalcubes_create_reduce_time_cube(SEXP pin, std::vector<std::string> reducers, std::vector<std::string> bands, uint32_t approx_quantile_compression) {
   try {
     Rcpp::XPtr< std::shared_ptr<cube> > aa = Rcpp::as<Rcpp::XPtr<std::shared_ptr<cube>>>(pin);
     
@@ -1095,6 +1280,13 @@ SEXP libgdalcubes_create_reduce_time_cube(SEXP pin, std::vector<std::string> red
       reducer_bands.push_back(std::make_pair(reducers[i], bands[i]));
     }
     
+    // reducers with mergeable partial states do not need complete pixel time series in memory
+    if (reduce_time_incremental_cube::supports(reducer_bands)) {
+      std::shared_ptr<reduce_time_incremental_cube>* x = new std::shared_ptr<reduce_time_incremental_cube>(reduce_time_incremental_cube::create(*aa, reducer_bands, approx_quantile_compression));
+      Rcpp::XPtr< std::shared_ptr<reduce_time_incremental_cube> > p(x, true) ;
+      return p;
+    }
+    
     std::shared_ptr<reduce_time_cube>* x = new std::shared_ptr<reduce_time_cube>(reduce_time_cube::create(*aa, reducer_bands));
     Rcpp::XPtr< std::shared_ptr<reduce_time_cube> > p(x, true) ;
     
@@ -1122,7 +1314,7 @@ SEXP libgdalcubes_create_stream_reduce_time_cube(SEXP pin, std::string cmd, uint
 
 
 // [[Rcpp::export]]
-SEXP libgdalcubes_create_reduce_space_cube(SEXP pin, std::vector<std::string> reducers, std::vector<std::string> bands) {
+SEXP libgdalcubes_create_reduce_space_cube(SEXP pin, std::vector<std::string> reducers, std::vector<std::string> bands, uint32_t approx_quantile_compression) {
   try {
     Rcpp::XPtr< std::shared_ptr<cube> > aa = Rcpp::as<Rcpp::XPtr<std::shared_ptr<cube>>>(pin);
     
@@ -1132,6 +1324,12 @@ SEXP libgdalcubes_create_reduce_space_cube(SEXP pin, std::vector<std::string> re
       reducer_bands.push_back(std::make_pair(reducers[i], bands[i]));
     }
     
+    if (reduce_space_incremental_cube::supports(reducer_bands)) {
+      std::shared_ptr<reduce_space_incremental_cube>* x = new std::shared_ptr<reduce_space_incremental_cube>(reduce_space_incremental_cube::create(*aa, reducer_bands, approx_quantile_compression));
+      Rcpp::XPtr< std::shared_ptr<reduce_space_incremental_cube> > p(x, true) ;
+      return p;
+    }
+    
     std::shared_ptr<reduce_space_cube>* x = new std::shared_ptr<reduce_space_cube>(reduce_space_cube::create(*aa, reducer_bands));
     Rcpp::XPtr< std::shared_ptr<reduce_space_cube> > p(x, true) ;
     
@@ -1155,6 +1353,12 @@ SEXP libgdalcubes_create_window_time_cube_reduce(SEXP pin, std::vector<int> wind
       reducer_bands.push_back(std::make_pair(reducers[i], bands[i]));
     }
     
+    if (window_time_sliding_cube::supports(reducer_bands)) {
+      std::shared_ptr<window_time_sliding_cube>* x = new std::shared_ptr<window_time_sliding_cube>(window_time_sliding_cube::create(*aa, reducer_bands, window[0], window[1]));
+      Rcpp::XPtr< std::shared_ptr<window_time_sliding_cube> > p(x, true) ;
+      return p;
+    }
+    
     std::shared_ptr<window_time_cube>* x = new std::shared_ptr<window_time_cube>(window_time_cube::create(*aa, reducer_bands, window[0], window[1]));
     Rcpp::XPtr< std::shared_ptr<window_time_cube> > p(x, true) ;
     
@@ -1171,8 +1375,8 @@ SEXP libgdalcubes_create_window_time_cube_kernel(SEXP pin, std::vector<int> wind
   try {
     Rcpp::XPtr< std::shared_ptr<cube> > aa = Rcpp::as<Rcpp::XPtr<std::shared_ptr<cube>>>(pin);
     
-    std::shared_ptr<window_time_cube>* x = new std::shared_ptr<window_time_cube>(window_time_cube::create(*aa, kernel, window[0], window[1]));
-    Rcpp::XPtr< std::shared_ptr<window_time_cube> > p(x, true) ;
+    std::shared_ptr<window_time_sliding_cube>* x = new std::shared_ptr<window_time_sliding_cube>(window_time_sliding_cube::create(*aa, kernel, window[0], window[1]));
+    Rcpp::XPtr< std::shared_ptr<window_time_sliding_cube> > p(x, true) ;
     return p;
     
   }
@@ -1284,11 +1488,37 @@ void libgdalcubes_eval_cube( SEXP pin, std::string outfile, uint8_t compression_
                              bool write_bounds = true,  SEXP packing = R_NilValue) {
   try {
     Rcpp::XPtr< std::shared_ptr<cube> > aa = Rcpp::as<Rcpp::XPtr< std::shared_ptr<cube> >>(pin);
-    packed_export p = packed_export::make_none();
+#ifdef GDALCUBES_HDF5_DIRECT_CHUNK
+    if (packing == R_NilValue && compression_level > 0 && !with_VRT) {
+      // compress chunks in worker threads and write them directly to the HDF5 datasets
+      typed_export::write_netcdf(*aa, outfile, element_type::FLOAT64, compression_level, write_bounds);
+      return;
+    }
+#endif
     if (packing != R_NilValue) {
       
       std::string type = Rcpp::as<Rcpp::List>(packing)["type"];
       
+      if (type == "float32") {
+        // values are stored as float, no scale / offset / nodata needed
+        if (with_VRT) {
+          GCBS_WARN("VRT datasets are not supported for float32 exports and will not be created");
+        }
+        typed_export::write_netcdf(*aa, outfile, element_type::FLOAT32, compression_level, write_bounds);
+        return;
+      }
+      gdalcubes::packing pk = packing_from_list(Rcpp::as<Rcpp::List>(packing));
+      if (!with_VRT || pk.is_auto()) {
+        // values are packed by the worker threads
+        if (with_VRT) {
+          GCBS_WARN("VRT datasets are not supported for automatic packing and will not be created");
+        }
+        typed_export::write_netcdf_packed(*aa, outfile, element_type_from_string(type), pk, compression_level, write_bounds);
+        return;
+      }
+      
+      // VRT datasets are only created by the library writer
+      packed_export p = packed_export::make_none();
       if (type == "uint8") {
         p.type = packed_export::packing_type::PACK_UINT8;
       }
@@ -1304,14 +1534,13 @@ void libgdalcubes_eval_cube( SEXP pin, std::string outfile, uint8_t compression_
       else if (type == "int32") {
         p.type = packed_export::packing_type::PACK_INT32;
       }
-      else {
-        // TODO: NO PACKING-> WARNING
-      }
-      p.offset = Rcpp::as<std::vector<double>>(Rcpp::as<Rcpp::List>(packing)["offset"]);
-      p.scale = Rcpp::as<std::vector<double>>(Rcpp::as<Rcpp::List>(packing)["scale"]);
-      p.nodata = Rcpp::as<std::vector<double>>(Rcpp::as<Rcpp::List>(packing)["nodata"]);
+      p.offset = pk.offset;
+      p.scale = pk.scale;
+      p.nodata = pk.nodata;
+      (*aa)->write_netcdf_file(outfile, compression_level, with_VRT, write_bounds, p);
+      return;
     }
-    (*aa)->write_netcdf_file(outfile, compression_level, with_VRT, write_bounds, p);
+    (*aa)->write_netcdf_file(outfile, compression_level, with_VRT, write_bounds, packed_export::make_none());
   }
   catch (std::string s) {
     Rcpp::stop(s);
@@ -1338,44 +1567,75 @@ void libgdalcubes_write_tif( SEXP pin, std::string dir, std::string prefix="",
       }
     }
     
-    packed_export p = packed_export::make_none();
-    if (packing != R_NilValue) {
-      
-      std::string type = Rcpp::as<Rcpp::List>(packing)["type"];
-      
-      if (type == "uint8") {
-        p.type = packed_export::packing_type::PACK_UINT8;
-      }
-      else if (type == "uint16") {
-        p.type = packed_export::packing_type::PACK_UINT16;
-      }
-      else if (type == "uint32") {
-        p.type = packed_export::packing_type::PACK_UINT32;
-      }
-      else if (type == "int16") {
-        p.type = packed_export::packing_type::PACK_INT16;
-      }
-      else if (type == "int32") {
-        p.type = packed_export::packing_type::PACK_INT32;
-      }
-      else {
-        // TODO: NO PACKING-> WARNING
-      }
-      
-      p.offset = Rcpp::as<std::vector<double>>(Rcpp::as<Rcpp::List>(packing)["offset"]);
-      p.scale = Rcpp::as<std::vector<double>>(Rcpp::as<Rcpp::List>(packing)["scale"]);
-      p.nodata = Rcpp::as<std::vector<double>>(Rcpp::as<Rcpp::List>(packing)["nodata"]);
+    if (packing == R_NilValue) {
+      (*aa)->write_tif_collection(dir, prefix, overviews, cog, co, rsmpl_overview, packed_export::make_none());
+      return;
     }
     
-    (*aa)->write_tif_collection(dir, prefix, overviews, cog, co, rsmpl_overview, p);
-    
-    
+    std::string type = Rcpp::as<Rcpp::List>(packing)["type"];
+    if (type == "float32") {
+      typed_export::write_tif(*aa, dir, prefix, element_type::FLOAT32, overviews, cog, co, rsmpl_overview);
+      return;
+    }
+    // values are packed by the worker threads
+    gdalcubes::packing pk = packing_from_list(Rcpp::as<Rcpp::List>(packing));
+    typed_export::write_tif_packed(*aa, dir, prefix, element_type_from_string(type), pk, overviews, cog, co, rsmpl_overview);
+  }
+  catch (std::string s) {
+    Rcpp::stop(s);
+  }
+}
+
+
+// [[Rcpp::export]]
+void libgdalcubes_write_zarr( SEXP pin, std::string dir, uint8_t compression_level=1, SEXP packing = R_NilValue) {
+  try {
+    Rcpp::XPtr< std::shared_ptr<cube> > aa = Rcpp::as<Rcpp::XPtr< std::shared_ptr<cube> >>(pin);
+    element_type type = element_type::FLOAT64;
+    if (packing != R_NilValue) {
+      std::string stype = Rcpp::as<Rcpp::List>(packing)["type"];
+      type = element_type_from_string(stype);
+    }
+    typed_export::write_zarr(*aa, dir, type, compression_level);
+  }
+  catch (std::string s) {
+    Rcpp::stop(s);
+  }
+}
+
+// [[Rcpp::export]]
+void libgdalcubes_write_cube_store( SEXP pin, std::string dir) {
+  try {
+    Rcpp::XPtr< std::shared_ptr<cube> > aa = Rcpp::as<Rcpp::XPtr< std::shared_ptr<cube> >>(pin);
+    cube_store_cube::write(*aa, dir);
+  }
+  catch (std::string s) {
+    Rcpp::stop(s);
+  }
+}
+
+// [[Rcpp::export]]
+uint32_t libgdalcubes_update_cube_store( SEXP pin, std::string dir) {
+  try {
+    Rcpp::XPtr< std::shared_ptr<cube> > aa = Rcpp::as<Rcpp::XPtr<std::shared_ptr<cube>>>(pin);
+    return cube_store_cube::update(*aa, dir);
   }
   catch (std::string s) {
     Rcpp::stop(s);
   }
 }
 
+// [[Rcpp::export]]
+SEXP libgdalcubes_open_cube_store(std::string dir) {
+  try {
+    std::shared_ptr<cube_store_cube>* x = new std::shared_ptr<cube_store_cube>( cube_store_cube::create(dir));
+    Rcpp::XPtr< std::shared_ptr<cube_store_cube> > p(x, true) ;
+    return p;
+  }
+  catch (std::string s) {
+    Rcpp::stop(s);
+  }
+}
 
 // [[Rcpp::export]]
 SEXP libgdalcubes_create_stream_cube(SEXP pin, std::string cmd) {
@@ -1397,6 +1657,11 @@ SEXP libgdalcubes_create_stream_cube(SEXP pin, std::string cmd) {
 SEXP libgdalcubes_create_fill_time_cube(SEXP pin, std::string method) {
   try {
     Rcpp::XPtr< std::shared_ptr<cube> > aa = Rcpp::as<Rcpp::XPtr< std::shared_ptr<cube> >>(pin);
+    if (fill_time_streaming_cube::supports(method)) {
+      std::shared_ptr<fill_time_streaming_cube>* x = new std::shared_ptr<fill_time_streaming_cube>( fill_time_streaming_cube::create(*aa, method));
+      Rcpp::XPtr< std::shared_ptr<fill_time_streaming_cube> > p(x, true) ;
+      return p;
+    }
     std::shared_ptr<fill_time_cube>* x = new std::shared_ptr<fill_time_cube>( fill_time_cube::create(*aa, method));
     Rcpp::XPtr< std::shared_ptr<fill_time_cube> > p(x, true) ;
     return p;
@@ -1409,13 +1674,22 @@ SEXP libgdalcubes_create_fill_time_cube(SEXP pin, std::string method) {
 
 
 // [[Rcpp::export]]
-SEXP libgdalcubes_query_points(SEXP pin, std::vector<double> px, std::vector<double> py, std::vector<std::string> pt, std::string srs) {
+SEXP libgdalcubes_query_points(SEXP pin, std::vector<double> px, std::vector<double> py, SEXP pt, std::string srs) {
   try {
     Rcpp::XPtr< std::shared_ptr<cube> > aa = Rcpp::as<Rcpp::XPtr< std::shared_ptr<cube> >>(pin);
-    std::vector<std::vector<double>> res = vector_queries::query_points(*aa, px, py, pt, srs);
+    
+    // query times are either date / time strings or seconds since 1970-01-01
+    std::vector<double> pt_sec;
+    if (TYPEOF(pt) == STRSXP) {
+      pt_sec = point_queries::epoch_seconds(Rcpp::as<std::vector<std::string>>(pt));
+    }
+    else {
+      pt_sec = Rcpp::as<std::vector<double>>(pt);
+    }
+    std::vector<std::vector<double>> res = point_queries::query_points(*aa, px, py, pt_sec, srs);
     Rcpp::List df(res.size());
   
-    for (uint16_t i=0; i<res.size(); ++i) {
+    for (uint32_t i=0; i<res.size(); ++i) {
      df[i] = res[i];
     }
     return df;
@@ -1426,6 +1700,106 @@ SEXP libgdalcubes_query_points(SEXP pin, std::vector<double> px, std::vector<dou
 }
 
 
+// [[Rcpp::export]]
+SEXP libgdalcubes_query_timeseries(SEXP pin, std::vector<double> px, std::vector<double> py, std::string srs) {
+  try {
+    Rcpp::XPtr< std::shared_ptr<cube> > aa = Rcpp::as<Rcpp::XPtr< std::shared_ptr<cube> >>(pin);
+    std::vector<double> res = point_queries::query_timeseries(*aa, px, py, srs);
+    
+    Rcpp::NumericVector arr(res.begin(), res.end());
+    arr.attr("dim") = Rcpp::IntegerVector::create(px.size(), (*aa)->size()[1], (*aa)->size()[0]);
+    return arr;
+  }
+  catch (std::string s) {
+    Rcpp::stop(s);
+  }
+}
+
+
+// [[Rcpp::export]]
+SEXP libgdalcubes_read_preview(SEXP pin, std::vector<std::string> bands, std::vector<int> t, uint32_t max_nx, uint32_t max_ny) {
+  try {
+    Rcpp::XPtr< std::shared_ptr<cube> > aa = Rcpp::as<Rcpp::XPtr< std::shared_ptr<cube> >>(pin);
+    std::shared_ptr<cube> c = cube_preview::prepare(*aa, bands, max_nx, max_ny);
+    uint32_t nx = std::min(max_nx, c->st_reference()->nx());
+    uint32_t ny = std::min(max_ny, c->st_reference()->ny());
+    std::vector<uint32_t> it(t.begin(), t.end());
+    std::vector<double> res = cube_preview::read(c, it, nx, ny);
+    
+    Rcpp::NumericVector arr(res.begin(), res.end());
+    arr.attr("dim") = Rcpp::IntegerVector::create(nx, ny, t.size(), c->bands().count());
+    return arr;
+  }
+  catch (std::string s) {
+    Rcpp::stop(s);
+  }
+}
+
+
+// [[Rcpp::export]]
+void libgdalcubes_preview(SEXP pin, std::vector<std::string> bands, std::vector<int> t, std::vector<int> max_nx, std::vector<int> max_ny, Rcpp::Function f) {
+  try {
+    Rcpp::XPtr< std::shared_ptr<cube> > aa = Rcpp::as<Rcpp::XPtr< std::shared_ptr<cube> >>(pin);
+    std::vector<uint32_t> it(t.begin(), t.end());
+    std::vector<uint32_t> nx(max_nx.begin(), max_nx.end());
+    std::vector<uint32_t> ny(max_ny.begin(), max_ny.end());
+    
+    // the callback is always called from this thread, later levels are computed in the background meanwhile;
+    // messages of background threads must not be printed while R is running, they are printed before each callback
+    struct output_hold {
+      output_hold() { error_handling_r::hold_output(true); }
+      ~output_hold() {
+        error_handling_r::hold_output(false);
+        error_handling_r::flush_output();
+      }
+    } hold;
+    cube_preview::progressive(*aa, bands, it, nx, ny, [&f, &t](uint32_t level, std::vector<double> &values, uint32_t lnx, uint32_t lny) {
+      error_handling_r::flush_output();
+      Rcpp::NumericVector arr(values.begin(), values.end());
+      uint32_t nb = values.size() / (uint64_t(lnx) * uint64_t(lny) * t.size());
+      arr.attr("dim") = Rcpp::IntegerVector::create(lnx, lny, t.size(), nb);
+      f(arr, level + 1);
+    });
+  }
+  catch (std::string s) {
+    Rcpp::stop(s);
+  }
+}
+
+
+// [[Rcpp::export]]
+SEXP libgdalcubes_zonal_statistics(SEXP pin, std::vector<std::string> wkt, std::string srs, std::vector<std::string> reducers, std::vector<std::string> bands, uint32_t approx_quantile_compression) {
+  try {
+    Rcpp::XPtr< std::shared_ptr<cube> > aa = Rcpp::as<Rcpp::XPtr< std::shared_ptr<cube> >>(pin);
+    
+    std::vector<std::pair<std::string, std::string>> reducer_bands;
+    for (uint16_t i=0; i<reducers.size(); ++i) {
+      reducer_bands.push_back(std::make_pair(reducers[i], bands[i]));
+    }
+    std::vector<std::vector<double>> res = zonal_statistics::compute(*aa, wkt, srs, reducer_bands, approx_quantile_compression);
+    Rcpp::List df(res.size());
+    
+    for (uint32_t i=0; i<res.size(); ++i) {
+      df[i] = res[i];
+    }
+    return df;
+  }
+  catch (std::string s) {
+    Rcpp::stop(s);
+  }
+}
+
+
+// [[Rcpp::export]]
+Rcpp::List libgdalcubes_mask_statistics(bool reset) {
+  lut_mask::statistics st = lut_mask::stats(reset);
+  return Rcpp::List::create(
+    Rcpp::Named("images") = double(st.images),
+    Rcpp::Named("masked_images") = double(st.masked_images),
+    Rcpp::Named("pixels") = double(st.pixels),
+    Rcpp::Named("masked_pixels") = double(st.masked_pixels));
+}
+
 // [[Rcpp::export]]
 void libgdalcubes_set_threads(IntegerVector n) {
   config::instance()->set_default_chunk_processor(std::dynamic_pointer_cast<chunk_processor>(std::make_shared<chunk_processor_multithread_interruptible>(n[0])));
@@ -0,0 +1,237 @@
+
+#include "image_metadata.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+
+namespace gdalcubes {
+
+namespace {
+
+void exec(sqlite3 *db, std::string sql, std::string fn) {
+    char *err = nullptr;
+    if (sqlite3_exec(db, sql.c_str(), NULL, NULL, &err) != SQLITE_OK) {
+        std::string msg = err ? err : "unknown error";
+        sqlite3_free(err);
+        throw std::string("ERROR in image_metadata::" + fn + "(): " + msg);
+    }
+}
+
+// check whether a table exists without modifying the database, such that read-only collections can be queried
+bool has_table(sqlite3 *db, std::string name) {
+    sqlite3_stmt *stmt = nullptr;
+    if (sqlite3_prepare_v2(db, "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = ?1;", -1, &stmt, NULL) != SQLITE_OK) {
+        throw std::string("ERROR in image_metadata: " + std::string(sqlite3_errmsg(db)));
+    }
+    sqlite3_bind_text(stmt, 1, name.c_str(), -1, SQLITE_TRANSIENT);
+    bool out = sqlite3_step(stmt) == SQLITE_ROW;
+    sqlite3_finalize(stmt);
+    return out;
+}
+
+// insert values of one attribute in a single transaction, bind(stmt, i) binds the value of the i-th image to parameter 2
+void put_values(sqlite3 *db, std::vector<std::string> &image_names, std::string key, std::function<bool(sqlite3_stmt *, uint32_t)> bind) {
+    sqlite3_stmt *stmt = nullptr;
+    std::string sql = "INSERT OR REPLACE INTO image_md (image_id, key, value) SELECT id, ?1, ?2 FROM images WHERE name = ?3;";
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+        throw std::string("ERROR in image_metadata::put(): " + std::string(sqlite3_errmsg(db)));
+    }
+    exec(db, "BEGIN TRANSACTION;", "put");
+    uint32_t nmissing = 0;
+    for (uint32_t i = 0; i < image_names.size(); ++i) {
+        sqlite3_reset(stmt);
+        sqlite3_bind_text(stmt, 1, key.c_str(), -1, SQLITE_TRANSIENT);
+        if (!bind(stmt, i)) continue;
+        sqlite3_bind_text(stmt, 3, image_names[i].c_str(), -1, SQLITE_TRANSIENT);
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            std::string msg = sqlite3_errmsg(db);
+            sqlite3_finalize(stmt);
+            exec(db, "ROLLBACK;", "put");
+            throw std::string("ERROR in image_metadata::put(): " + msg);
+        }
+        nmissing += sqlite3_changes(db) == 0;
+    }
+    sqlite3_finalize(stmt);
+    exec(db, "COMMIT;", "put");
+    if (nmissing > 0) {
+        GCBS_WARN(std::to_string(nmissing) + " image name(s) not found in the image collection, attribute values have been ignored");
+    }
+}
+
+}  // namespace
+
+bool image_metadata::is_reserved(std::string key) {
+    static const std::vector<std::string> reserved = {"id", "image_id", "name", "left", "top", "bottom", "right", "datetime", "proj"};
+    return key.empty() || std::find(reserved.begin(), reserved.end(), key) != reserved.end();
+}
+
+void image_metadata::create_table(sqlite3 *db) {
+    // value has no declared type, i.e. numbers and strings keep their type
+    exec(db, "CREATE TABLE IF NOT EXISTS image_md (image_id INTEGER, key TEXT, value, PRIMARY KEY (image_id, key));", "create_table");
+    exec(db, "CREATE TABLE IF NOT EXISTS image_epoch (image_id INTEGER PRIMARY KEY, epoch INTEGER);", "create_table");
+}
+
+void image_metadata::put(std::shared_ptr<image_collection> ic, std::vector<std::string> image_names, std::string key, std::vector<double> values) {
+    if (image_names.size() != values.size()) {
+        throw std::string("ERROR in image_metadata::put(): Expected one value per image");
+    }
+    if (is_reserved(key)) {
+        throw std::string("ERROR in image_metadata::put(): '" + key + "' is not allowed as attribute name");
+    }
+    create_table(ic->get_db_handle());
+    put_values(ic->get_db_handle(), image_names, key, [&values](sqlite3_stmt *stmt, uint32_t i) {
+        if (std::isnan(values[i])) return false;
+        sqlite3_bind_double(stmt, 2, values[i]);
+        return true;
+    });
+}
+
+void image_metadata::put(std::shared_ptr<image_collection> ic, std::vector<std::string> image_names, std::string key, std::vector<std::string> values) {
+    if (image_names.size() != values.size()) {
+        throw std::string("ERROR in image_metadata::put(): Expected one value per image");
+    }
+    if (is_reserved(key)) {
+        throw std::string("ERROR in image_metadata::put(): '" + key + "' is not allowed as attribute name");
+    }
+    create_table(ic->get_db_handle());
+    put_values(ic->get_db_handle(), image_names, key, [&values](sqlite3_stmt *stmt, uint32_t i) {
+        sqlite3_bind_text(stmt, 2, values[i].c_str(), -1, SQLITE_TRANSIENT);
+        return true;
+    });
+}
+
+std::vector<image_metadata::md_row> image_metadata::get(std::shared_ptr<image_collection> ic) {
+    std::vector<md_row> out;
+    sqlite3 *db = ic->get_db_handle();
+    if (!has_table(db, "image_md")) return out;
+    sqlite3_stmt *stmt = nullptr;
+    std::string sql = "SELECT image_id, key, value FROM image_md ORDER BY image_id, key;";
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+        throw std::string("ERROR in image_metadata::get(): " + std::string(sqlite3_errmsg(db)));
+    }
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        md_row r;
+        r.image_id = sqlite3_column_int(stmt, 0);
+        r.key = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 1));
+        int type = sqlite3_column_type(stmt, 2);
+        r.numeric = (type == SQLITE_INTEGER || type == SQLITE_FLOAT);
+        r.num = r.numeric ? sqlite3_column_double(stmt, 2) : NAN;
+        const unsigned char *s = sqlite3_column_text(stmt, 2);
+        r.str = s ? reinterpret_cast<const char *>(s) : "";
+        out.push_back(r);
+    }
+    sqlite3_finalize(stmt);
+    return out;
+}
+
+std::shared_ptr<image_collection> image_metadata::filter(std::shared_ptr<image_collection> ic, std::string predicate, std::string outfile) {
+    ic->write(outfile);
+    std::shared_ptr<image_collection> out = std::make_shared<image_collection>(outfile);
+    try {
+        sqlite3 *db = out->get_db_handle();
+        create_table(db);
+
+        // one column per attribute
+        std::string columns;
+        sqlite3_stmt *stmt = nullptr;
+        if (sqlite3_prepare_v2(db, "SELECT DISTINCT key FROM image_md;", -1, &stmt, NULL) != SQLITE_OK) {
+            throw std::string("ERROR in image_metadata::filter(): " + std::string(sqlite3_errmsg(db)));
+        }
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            char *col = sqlite3_mprintf(", MAX(CASE WHEN key = %Q THEN value END) AS \"%w\"", sqlite3_column_text(stmt, 0), sqlite3_column_text(stmt, 0));
+            columns += col;
+            sqlite3_free(col);
+        }
+        sqlite3_finalize(stmt);
+
+        std::string sql =
+            "DELETE FROM images WHERE id NOT IN (SELECT images.id FROM images LEFT JOIN "
+            "(SELECT image_id" + columns + " FROM image_md GROUP BY image_id) md ON images.id = md.image_id WHERE " + predicate + ");";
+        exec(db, "BEGIN TRANSACTION;", "filter");
+        try {
+            exec(db, sql, "filter");
+            exec(db, "DELETE FROM gdalrefs WHERE image_id NOT IN (SELECT id FROM images);", "filter");
+            exec(db, "DELETE FROM image_md WHERE image_id NOT IN (SELECT id FROM images);", "filter");
+            exec(db, "DELETE FROM image_epoch WHERE image_id NOT IN (SELECT id FROM images);", "filter");
+        } catch (std::string s) {
+            exec(db, "ROLLBACK;", "filter");
+            throw s;
+        }
+        exec(db, "COMMIT;", "filter");
+
+        if (out->count_images() == 0) {
+            throw std::string("ERROR in image_metadata::filter(): No images of the collection match '" + predicate + "'");
+        }
+    } catch (...) {
+        // do not leave copies behind that are not returned to the caller
+        out.reset();
+        std::remove(outfile.c_str());
+        throw;
+    }
+    GCBS_DEBUG(std::to_string(out->count_images()) + " of " + std::to_string(ic->count_images()) + " images match '" + predicate + "'");
+    return out;
+}
+
+uint32_t image_metadata::epoch(std::shared_ptr<image_collection> ic) {
+    sqlite3 *db = ic->get_db_handle();
+    if (!has_table(db, "image_epoch")) return 0;
+    sqlite3_stmt *stmt = nullptr;
+    if (sqlite3_prepare_v2(db, "SELECT COALESCE(MAX(epoch), 0) FROM image_epoch;", -1, &stmt, NULL) != SQLITE_OK) {
+        throw std::string("ERROR in image_metadata::epoch(): " + std::string(sqlite3_errmsg(db)));
+    }
+    uint32_t out = 0;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        out = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return out;
+}
+
+uint32_t image_metadata::max_image_id(std::shared_ptr<image_collection> ic) {
+    sqlite3 *db = ic->get_db_handle();
+    sqlite3_stmt *stmt = nullptr;
+    if (sqlite3_prepare_v2(db, "SELECT COALESCE(MAX(id), 0) FROM images;", -1, &stmt, NULL) != SQLITE_OK) {
+        throw std::string("ERROR in image_metadata::max_image_id(): " + std::string(sqlite3_errmsg(db)));
+    }
+    uint32_t out = 0;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        out = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return out;
+}
+
+void image_metadata::mark_added(std::shared_ptr<image_collection> ic, uint32_t after_id) {
+    create_table(ic->get_db_handle());
+    uint32_t e = epoch(ic) + 1;
+    exec(ic->get_db_handle(), "INSERT OR REPLACE INTO image_epoch (image_id, epoch) SELECT id, " + std::to_string(e) +
+                                  " FROM images WHERE id > " + std::to_string(after_id) + ";",
+         "mark_added");
+}
+
+std::vector<image_metadata::footprint> image_metadata::added_since(std::shared_ptr<image_collection> ic, uint32_t epoch) {
+    std::vector<footprint> out;
+    sqlite3 *db = ic->get_db_handle();
+    if (!has_table(db, "image_epoch")) return out;
+    sqlite3_stmt *stmt = nullptr;
+    std::string sql = "SELECT images.\"left\", images.\"right\", images.\"bottom\", images.\"top\", images.datetime FROM images "
+                      "INNER JOIN image_epoch ON images.id = image_epoch.image_id WHERE image_epoch.epoch > " + std::to_string(epoch) + ";";
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+        throw std::string("ERROR in image_metadata::added_since(): " + std::string(sqlite3_errmsg(db)));
+    }
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        footprint f;
+        f.left = sqlite3_column_double(stmt, 0);
+        f.right = sqlite3_column_double(stmt, 1);
+        f.bottom = sqlite3_column_double(stmt, 2);
+        f.top = sqlite3_column_double(stmt, 3);
+        f.datetime = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 4));
+        out.push_back(f);
+    }
+    sqlite3_finalize(stmt);
+    return out;
+}
+
+}  // namespace gdalcubes
@@ -0,0 +1,124 @@
+
+#ifndef IMAGE_METADATA_H
+#define IMAGE_METADATA_H
+
+#include "gdalcubes/src/gdalcubes.h"
+
+#include <sqlite3.h>
+
+namespace gdalcubes {
+
+/**
+ * @brief Additional per-image attributes (e.g. cloud cover, tile, or orbit) of image collections
+ *
+ * Attributes are stored as key / value pairs in an additional table image_md of the image collection's SQLite database.
+ * Values are stored either as numbers or as strings. Collections with attributes can be filtered by an SQL expression before
+ * creating a data cube, such that excluded images are never opened. A second table image_epoch tracks when images have been
+ * added to the collection, such that derived results can be updated incrementally.
+ */
+class image_metadata {
+   public:
+    /**
+     * @brief Single attribute value of an image
+     */
+    struct md_row {
+        uint32_t image_id;
+        std::string key;
+        bool numeric;
+        double num;
+        std::string str;
+    };
+
+    /**
+     * @brief Spatial extent (WGS84) and acquisition date / time of an image
+     */
+    struct footprint {
+        double left;
+        double right;
+        double bottom;
+        double top;
+        std::string datetime;
+    };
+
+    /**
+     * @brief Set numeric attribute values of images
+     * @param ic image collection, modified in place
+     * @param image_names names of images as in the images table, images with the same name receive the same value
+     * @param key attribute name
+     * @param values attribute values, same length as image_names, NAN values are not stored
+     */
+    static void put(std::shared_ptr<image_collection> ic, std::vector<std::string> image_names, std::string key, std::vector<double> values);
+
+    /**
+     * @brief Set string attribute values of images
+     * @copydetails put()
+     */
+    static void put(std::shared_ptr<image_collection> ic, std::vector<std::string> image_names, std::string key, std::vector<std::string> values);
+
+    /**
+     * @brief Get all attribute values of a collection
+     * @param ic image collection
+     * @return one row per image and attribute, ordered by image id and key
+     */
+    static std::vector<md_row> get(std::shared_ptr<image_collection> ic);
+
+    /**
+     * @brief Create a copy of an image collection containing only images whose attributes fulfill a predicate
+     *
+     * The predicate is an SQL expression referring to attributes by their names, e.g. "cloud_cover < 30 AND orbit = 'R065'",
+     * or to the columns name and datetime of the images table. Attributes that are missing for an image are NULL.
+     *
+     * @param ic image collection, not modified
+     * @param predicate SQL expression
+     * @param outfile path of the filtered collection file, the file is deleted if filtering fails or no image matches
+     * @return filtered image collection
+     */
+    static std::shared_ptr<image_collection> filter(std::shared_ptr<image_collection> ic, std::string predicate, std::string outfile);
+
+    /**
+     * @brief Get the current insertion epoch of a collection
+     *
+     * Images are assigned to epochs in table image_epoch when they are added to an existing collection with mark_added().
+     * Images of the initial collection belong to epoch 0.
+     * @param ic image collection
+     * @return largest epoch of all images
+     */
+    static uint32_t epoch(std::shared_ptr<image_collection> ic);
+
+    /**
+     * @brief Get the largest image id of a collection, 0 if the collection is empty
+     */
+    static uint32_t max_image_id(std::shared_ptr<image_collection> ic);
+
+    /**
+     * @brief Assign all images with an id larger than after_id to a new epoch
+     * @param ic image collection, modified in place
+     * @param after_id result of max_image_id() before images have been added
+     */
+    static void mark_added(std::shared_ptr<image_collection> ic, uint32_t after_id);
+
+    /**
+     * @brief Get footprints of all images added after a given epoch
+     * @param ic image collection
+     * @param epoch epoch, e.g. as returned by epoch() before adding images
+     */
+    static std::vector<footprint> added_since(std::shared_ptr<image_collection> ic, uint32_t epoch);
+
+    /**
+     * @brief Create the tables image_md and image_epoch if they do not exist
+     *
+     * Only functions that write attributes or epochs create the tables. Read-only queries return empty results for
+     * collections without these tables, such that they never modify the collection file.
+     * @param db database handle of an image collection
+     */
+    static void create_table(sqlite3 *db);
+
+    /**
+     * @brief Check whether a name cannot be used as attribute name because it refers to a column of the images table
+     */
+    static bool is_reserved(std::string key);
+};
+
+}  // namespace gdalcubes
+
+#endif  //IMAGE_METADATA_H
@@ -0,0 +1,431 @@
+
+#ifndef INCREMENTAL_REDUCER_H
+#define INCREMENTAL_REDUCER_H
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace gdalcubes {
+
+/**
+ * @brief Reducer with mergeable partial state over a fixed number of cells
+ *
+ * In contrast to the reducers of the library, which see all values of a pixel time series at once, incremental reducers
+ * maintain a small partial state per cell (e.g. count / sum / min / max) that is updated with one value per cell at a time.
+ * Partial states computed from disjoint parts of the data (e.g. different time chunks) can be merged, i.e.,
+ * memory consumption does not depend on the number of values that are reduced.
+ *
+ * NAN values are ignored in all implementations.
+ */
+class incremental_reducer {
+   public:
+    virtual ~incremental_reducer() {}
+
+    /**
+     * @brief Allocate and reset the partial state
+     * @param n number of cells
+     */
+    virtual void init(uint64_t n) = 0;
+
+    /**
+     * @brief Add one value per cell to the partial state
+     * @param v pointer to n values, one for each cell
+     * @param idx global index of the values along the reduced dimension, used by which_min and which_max
+     */
+    virtual void update(const double *v, uint32_t idx) = 0;
+
+    /**
+     * @brief Add several values to the partial state of a single cell
+     * @param i cell index
+     * @param v pointer to n values
+     * @param n number of values
+     * @param idx0 global index of the first value along the reduced dimension, used by which_min and which_max
+     */
+    virtual void update_cell(uint64_t i, const double *v, uint64_t n, uint32_t idx0) = 0;
+
+    /**
+     * @brief Merge the partial state of another reducer of the same type and size into this reducer
+     * @param other other reducer, must have been created with the same name and initialized with the same number of cells
+     */
+    virtual void merge(incremental_reducer *other) = 0;
+
+    /**
+     * @brief Compute final results from the partial state
+     * @param out output buffer with n elements
+     */
+    virtual void finalize(double *out) = 0;
+
+    /**
+     * @brief Create a reducer by name
+     * @param name one of "count", "sum", "prod", "mean", "var", "sd", "min", "max", "which_min", "which_max",
+     * "approx_median", or "approx_quantileXX" where XX are the decimal places of the probability, e.g. "approx_quantile25"
+     * or "approx_quantile975"
+     * @param compression compression parameter of approximate quantile reducers, see tdigest_incremental_reducer
+     * @return reducer, or nullptr if there is no incremental implementation for the given name
+     */
+    static std::shared_ptr<incremental_reducer> create(std::string name, uint32_t compression = 50);
+
+    /**
+     * @brief Check whether an incremental implementation of a reducer exists
+     */
+    static bool is_supported(std::string name) {
+        return create(name) != nullptr;
+    }
+};
+
+/**
+ * @brief Base class of incremental reducers implementing loops over cells
+ *
+ * Derived classes implement per-cell operations add(), merge_cell(), and result() that are inlined into the loops.
+ * @tparam Derived derived reducer class
+ */
+template <class Derived>
+class incremental_reducer_base : public incremental_reducer {
+   public:
+    void init(uint64_t n) override {
+        _n = n;
+        derived()->reset(n);
+    }
+    void update(const double *v, uint32_t idx) override {
+        Derived *d = derived();
+        for (uint64_t i = 0; i < _n; ++i) {
+            d->add(i, v[i], idx);
+        }
+    }
+    void update_cell(uint64_t i, const double *v, uint64_t n, uint32_t idx0) override {
+        Derived *d = derived();
+        for (uint64_t k = 0; k < n; ++k) {
+            d->add(i, v[k], idx0 + k);
+        }
+    }
+    void merge(incremental_reducer *other) override {
+        Derived *d = derived();
+        Derived *o = static_cast<Derived *>(other);
+        for (uint64_t i = 0; i < _n; ++i) {
+            d->merge_cell(i, o);
+        }
+    }
+    void finalize(double *out) override {
+        Derived *d = derived();
+        for (uint64_t i = 0; i < _n; ++i) {
+            out[i] = d->result(i);
+        }
+    }
+
+   protected:
+    uint64_t _n = 0;
+
+   private:
+    inline Derived *derived() { return static_cast<Derived *>(this); }
+};
+
+class count_incremental_reducer : public incremental_reducer_base<count_incremental_reducer> {
+   public:
+    void reset(uint64_t n) { _count.assign(n, 0); }
+    inline void add(uint64_t i, double x, uint32_t idx) { _count[i] += !std::isnan(x); }
+    inline void merge_cell(uint64_t i, count_incremental_reducer *o) { _count[i] += o->_count[i]; }
+    inline double result(uint64_t i) { return _count[i]; }
+
+   private:
+    std::vector<uint32_t> _count;
+};
+
+class sum_incremental_reducer : public incremental_reducer_base<sum_incremental_reducer> {
+   public:
+    void reset(uint64_t n) {
+        _sum.assign(n, 0);
+        _count.assign(n, 0);
+    }
+    inline void add(uint64_t i, double x, uint32_t idx) {
+        bool valid = !std::isnan(x);
+        _sum[i] += valid ? x : 0;
+        _count[i] += valid;
+    }
+    inline void merge_cell(uint64_t i, sum_incremental_reducer *o) {
+        _sum[i] += o->_sum[i];
+        _count[i] += o->_count[i];
+    }
+    inline double result(uint64_t i) { return (_count[i] > 0) ? _sum[i] : NAN; }
+
+   private:
+    std::vector<double> _sum;
+    std::vector<uint32_t> _count;
+};
+
+class mean_incremental_reducer : public incremental_reducer_base<mean_incremental_reducer> {
+   public:
+    void reset(uint64_t n) {
+        _sum.assign(n, 0);
+        _count.assign(n, 0);
+    }
+    inline void add(uint64_t i, double x, uint32_t idx) {
+        bool valid = !std::isnan(x);
+        _sum[i] += valid ? x : 0;
+        _count[i] += valid;
+    }
+    inline void merge_cell(uint64_t i, mean_incremental_reducer *o) {
+        _sum[i] += o->_sum[i];
+        _count[i] += o->_count[i];
+    }
+    inline double result(uint64_t i) { return (_count[i] > 0) ? _sum[i] / _count[i] : NAN; }
+
+   private:
+    std::vector<double> _sum;
+    std::vector<uint32_t> _count;
+};
+
+class prod_incremental_reducer : public incremental_reducer_base<prod_incremental_reducer> {
+   public:
+    void reset(uint64_t n) {
+        _prod.assign(n, 1);
+        _count.assign(n, 0);
+    }
+    inline void add(uint64_t i, double x, uint32_t idx) {
+        bool valid = !std::isnan(x);
+        _prod[i] *= valid ? x : 1;
+        _count[i] += valid;
+    }
+    inline void merge_cell(uint64_t i, prod_incremental_reducer *o) {
+        _prod[i] *= o->_prod[i];
+        _count[i] += o->_count[i];
+    }
+    inline double result(uint64_t i) { return (_count[i] > 0) ? _prod[i] : NAN; }
+
+   private:
+    std::vector<double> _prod;
+    std::vector<uint32_t> _count;
+};
+
+/**
+ * @brief Sample variance or standard deviation using Welford's online algorithm, partial states are merged with the
+ * parallel algorithm of Chan et al.
+ * @tparam SD true for standard deviation, false for variance
+ */
+template <bool SD>
+class var_incremental_reducer : public incremental_reducer_base<var_incremental_reducer<SD>> {
+   public:
+    void reset(uint64_t n) {
+        _count.assign(n, 0);
+        _mean.assign(n, 0);
+        _m2.assign(n, 0);
+    }
+    inline void add(uint64_t i, double x, uint32_t idx) {
+        if (std::isnan(x)) return;
+        _count[i] += 1;
+        double delta = x - _mean[i];
+        _mean[i] += delta / _count[i];
+        _m2[i] += delta * (x - _mean[i]);
+    }
+    inline void merge_cell(uint64_t i, var_incremental_reducer<SD> *o) {
+        if (o->_count[i] == 0) return;
+        double n = double(_count[i]) + double(o->_count[i]);
+        double delta = o->_mean[i] - _mean[i];
+        _m2[i] += o->_m2[i] + delta * delta * _count[i] * o->_count[i] / n;
+        _mean[i] += delta * o->_count[i] / n;
+        _count[i] += o->_count[i];
+    }
+    inline double result(uint64_t i) {
+        double var = (_count[i] > 1) ? _m2[i] / (_count[i] - 1) : NAN;
+        return SD ? std::sqrt(var) : var;
+    }
+
+   private:
+    std::vector<uint32_t> _count;
+    std::vector<double> _mean;
+    std::vector<double> _m2;
+};
+
+/**
+ * @brief Minimum or maximum and (optionally) the index where it occurs
+ * @tparam MAX true for maximum, false for minimum
+ * @tparam WHICH true to return the index instead of the value
+ */
+template <bool MAX, bool WHICH>
+class extremum_incremental_reducer : public incremental_reducer_base<extremum_incremental_reducer<MAX, WHICH>> {
+   public:
+    void reset(uint64_t n) {
+        _val.assign(n, NAN);
+        _idx.assign(n, 0);
+    }
+    inline void add(uint64_t i, double x, uint32_t idx) {
+        if (better(x, _val[i])) {
+            _val[i] = x;
+            _idx[i] = idx;
+        }
+    }
+    inline void merge_cell(uint64_t i, extremum_incremental_reducer<MAX, WHICH> *o) {
+        // on ties, prefer the smaller index to get the same result independent of the merge order
+        if (better(o->_val[i], _val[i]) || (o->_val[i] == _val[i] && o->_idx[i] < _idx[i])) {
+            _val[i] = o->_val[i];
+            _idx[i] = o->_idx[i];
+        }
+    }
+    inline double result(uint64_t i) {
+        return WHICH ? (std::isnan(_val[i]) ? NAN : double(_idx[i])) : _val[i];
+    }
+
+   private:
+    static inline bool better(double a, double b) {
+        if (std::isnan(a)) return false;
+        if (std::isnan(b)) return true;
+        return MAX ? (a > b) : (a < b);
+    }
+    std::vector<double> _val;
+    std::vector<uint32_t> _idx;
+};
+
+/**
+ * @brief Approximate quantiles based on a merging t-digest per cell
+ *
+ * Each cell stores at most about 2 * compression centroids. As long as a cell received fewer values, all values are kept
+ * and the result is identical to the exact quantile (type 7 as in R's quantile()). Larger compression values increase
+ * accuracy and memory consumption. A centroid takes 16 bytes and the capacity of a cell is kept after compression,
+ * i.e., with the default compression of 50, a cell may hold up to 128 centroids (2 KB) and the state of a 256 x 256 chunk
+ * may grow to about 140 MB per reducer and thread. Exact quantiles of the library keep 8 bytes per value, i.e. they need
+ * less memory for time series with fewer than about 4 * compression values.
+ */
+class tdigest_incremental_reducer : public incremental_reducer_base<tdigest_incremental_reducer> {
+   public:
+    /**
+     * @param p probability of the quantile, 0.5 computes the median
+     * @param compression compression parameter, maximum number of centroids per cell is about 2 * compression
+     */
+    tdigest_incremental_reducer(double p, uint32_t compression = 50) : _p(p), _compression(compression) {}
+
+    void reset(uint64_t n) {
+        _c.assign(n, std::vector<centroid>());
+        _min.assign(n, NAN);
+        _max.assign(n, NAN);
+    }
+    inline void add(uint64_t i, double x, uint32_t idx) {
+        if (std::isnan(x)) return;
+        _c[i].push_back({x, 1});
+        if (!(x >= _min[i])) _min[i] = x;
+        if (!(x <= _max[i])) _max[i] = x;
+        if (_c[i].size() > 2 * _compression) {
+            compress(_c[i]);
+        }
+    }
+    inline void merge_cell(uint64_t i, tdigest_incremental_reducer *o) {
+        if (o->_c[i].empty()) return;
+        _c[i].insert(_c[i].end(), o->_c[i].begin(), o->_c[i].end());
+        if (!(o->_min[i] >= _min[i])) _min[i] = o->_min[i];
+        if (!(o->_max[i] <= _max[i])) _max[i] = o->_max[i];
+        if (_c[i].size() > 2 * _compression) {
+            compress(_c[i]);
+        }
+    }
+    double result(uint64_t i);
+
+   private:
+    struct centroid {
+        double mean;
+        double weight;
+    };
+
+    void compress(std::vector<centroid> &c);
+
+    // scale function k1 and its inverse
+    inline double k(double q) { return _compression / (2 * pi()) * std::asin(2 * q - 1); }
+    inline double k_inv(double k) { return (std::sin(k * 2 * pi() / _compression) + 1) / 2; }
+    static inline double pi() { return 3.14159265358979323846; }
+
+    double _p;
+    uint32_t _compression;
+    std::vector<std::vector<centroid>> _c;
+    std::vector<double> _min;
+    std::vector<double> _max;
+};
+
+inline void tdigest_incremental_reducer::compress(std::vector<centroid> &c) {
+    std::sort(c.begin(), c.end(), [](const centroid &a, const centroid &b) { return a.mean < b.mean; });
+    double total = 0;
+    for (uint32_t j = 0; j < c.size(); ++j) {
+        total += c[j].weight;
+    }
+    uint32_t n_out = 0;
+    double w_sofar = 0;
+    double q_limit = k_inv(std::min(k(0) + 1, _compression / 4.0));
+    centroid cur = c[0];
+    for (uint32_t j = 1; j < c.size(); ++j) {
+        double q = (w_sofar + cur.weight + c[j].weight) / total;
+        if (q <= q_limit) {
+            cur.mean += (c[j].mean - cur.mean) * c[j].weight / (cur.weight + c[j].weight);
+            cur.weight += c[j].weight;
+        } else {
+            w_sofar += cur.weight;
+            c[n_out++] = cur;
+            q_limit = k_inv(std::min(k(w_sofar / total) + 1, _compression / 4.0));
+            cur = c[j];
+        }
+    }
+    c[n_out++] = cur;
+    // keep the capacity, the cell will grow to the same size until the next compression
+    c.resize(n_out);
+}
+
+inline double tdigest_incremental_reducer::result(uint64_t i) {
+    std::vector<centroid> &c = _c[i];
+    if (c.empty()) return NAN;
+    std::sort(c.begin(), c.end(), [](const centroid &a, const centroid &b) { return a.mean < b.mean; });
+    double total = 0;
+    for (uint32_t j = 0; j < c.size(); ++j) {
+        total += c[j].weight;
+    }
+    if (total == c.size()) {
+        // no values have been merged, compute exact quantile
+        double h = (total - 1) * _p;
+        uint32_t lo = std::floor(h);
+        if (lo + 1 >= c.size()) return c[lo].mean;
+        return c[lo].mean + (h - lo) * (c[lo + 1].mean - c[lo].mean);
+    }
+
+    // interpolate between centroid centers, and between min / max and the first / last centroid
+    double target = _p * total;
+    if (target <= c[0].weight / 2) {
+        return _min[i] + (c[0].mean - _min[i]) * target / (c[0].weight / 2);
+    }
+    double cum = 0;
+    for (uint32_t j = 0; j + 1 < c.size(); ++j) {
+        double center_cur = cum + c[j].weight / 2;
+        double center_next = cum + c[j].weight + c[j + 1].weight / 2;
+        if (target <= center_next) {
+            return c[j].mean + (target - center_cur) / (center_next - center_cur) * (c[j + 1].mean - c[j].mean);
+        }
+        cum += c[j].weight;
+    }
+    const centroid &last = c.back();
+    return last.mean + (target - (total - last.weight / 2)) / (last.weight / 2) * (_max[i] - last.mean);
+}
+
+inline std::shared_ptr<incremental_reducer> incremental_reducer::create(std::string name, uint32_t compression) {
+    if (name == "count") return std::make_shared<count_incremental_reducer>();
+    if (name == "sum") return std::make_shared<sum_incremental_reducer>();
+    if (name == "prod") return std::make_shared<prod_incremental_reducer>();
+    if (name == "mean") return std::make_shared<mean_incremental_reducer>();
+    if (name == "var") return std::make_shared<var_incremental_reducer<false>>();
+    if (name == "sd") return std::make_shared<var_incremental_reducer<true>>();
+    if (name == "min") return std::make_shared<extremum_incremental_reducer<false, false>>();
+    if (name == "max") return std::make_shared<extremum_incremental_reducer<true, false>>();
+    if (name == "which_min") return std::make_shared<extremum_incremental_reducer<false, true>>();
+    if (name == "which_max") return std::make_shared<extremum_incremental_reducer<true, true>>();
+    if (name == "approx_median") return std::make_shared<tdigest_incremental_reducer>(0.5, compression);
+    if (name.compare(0, 15, "approx_quantile") == 0 && name.size() > 15) {
+        std::string digits = name.substr(15);
+        if (!std::all_of(digits.begin(), digits.end(), [](char ch) { return std::isdigit(ch); })) {
+            return nullptr;
+        }
+        return std::make_shared<tdigest_incremental_reducer>(std::stod("0." + digits), compression);
+    }
+    return nullptr;
+}
+
+}  // namespace gdalcubes
+
+#endif  //INCREMENTAL_REDUCER_H
@@ -0,0 +1,318 @@
+
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Elementwise kernels operating on contiguous chunk buffers of the package-side
+ * operators and exporters. Kernels are templated on the element type such that
+ * the same implementation can be used for double (the native type of chunk_data)
+ * and float (used for reduced-size chunk storage and export).
+ *
+ * Loops are kept simple and branch-free where possible to allow auto-vectorization by
+ * the compiler.
+ */
+namespace gdalcubes {
+namespace kernels {
+
+/**
+ * @brief Convert a buffer of double values to another element type
+ * @note NaN values are preserved
+ * @param in input buffer
+ * @param out output buffer, must be allocated with at least n elements
+ * @param n number of elements
+ */
+template <typename Tout>
+inline void convert(const double *in, Tout *out, uint64_t n) {
+    for (uint64_t i = 0; i < n; ++i) {
+        out[i] = static_cast<Tout>(in[i]);
+    }
+}
+
+/**
+ * @brief Pack a buffer of double values to an integer type
+ *
+ * Values are packed as round((v - offset) / scale) and clamped to [lo, hi], NaN values are mapped to nodata.
+ * Clamping is applied before the NaN check, such that the conversion never sees NaN and the loop
+ * contains no data-dependent branches.
+ *
+ * @param in input buffer
+ * @param out output buffer, must be allocated with at least n elements
+ * @param n number of elements
+ * @param offset packing offset
+ * @param scale packing scale
+ * @param nodata packed value of NaN
+ * @param lo smallest valid packed value
+ * @param hi largest valid packed value
+ */
+template <typename Tout>
+inline void pack(const double *in, Tout *out, uint64_t n, double offset, double scale, Tout nodata, double lo, double hi) {
+    double inv_scale = 1.0 / scale;
+    for (uint64_t i = 0; i < n; ++i) {
+        double v = std::floor((in[i] - offset) * inv_scale + 0.5);
+        v = std::max(lo, std::min(hi, v));  // NaN becomes hi here
+        out[i] = (in[i] == in[i]) ? static_cast<Tout>(v) : nodata;
+    }
+}
+
+/**
+ * @brief Update the minimum and maximum of non-NaN values in a buffer
+ * @param in input buffer
+ * @param n number of elements
+ * @param vmin current minimum, updated in place
+ * @param vmax current maximum, updated in place
+ */
+inline void minmax(const double *in, uint64_t n, double &vmin, double &vmax) {
+    double lo = vmin, hi = vmax;
+    for (uint64_t i = 0; i < n; ++i) {
+        // comparisons with NaN are false, i.e. NaN values are skipped
+        lo = (in[i] < lo) ? in[i] : lo;
+        hi = (in[i] > hi) ? in[i] : hi;
+    }
+    vmin = lo;
+    vmax = hi;
+}
+
+/**
+ * @brief In-place iterative radix-2 fast Fourier transform
+ * @param a complex input / output values, the size must be a power of two
+ * @param inverse compute the inverse transform including the 1/n normalization
+ */
+inline void fft(std::vector<std::complex<double>> &a, bool inverse) {
+    uint64_t n = a.size();
+    for (uint64_t i = 1, j = 0; i < n; ++i) {
+        uint64_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) std::swap(a[i], a[j]);
+    }
+    for (uint64_t len = 2; len <= n; len <<= 1) {
+        double ang = 2 * 3.14159265358979323846 / len * (inverse ? 1 : -1);
+        std::complex<double> wlen(std::cos(ang), std::sin(ang));
+        for (uint64_t i = 0; i < n; i += len) {
+            std::complex<double> w(1);
+            for (uint64_t j = 0; j < len / 2; ++j) {
+                std::complex<double> u = a[i + j];
+                std::complex<double> v = a[i + j + len / 2] * w;
+                a[i + j] = u + v;
+                a[i + j + len / 2] = u - v;
+                w *= wlen;
+            }
+        }
+    }
+    if (inverse) {
+        for (uint64_t i = 0; i < n; ++i) {
+            a[i] /= double(n);
+        }
+    }
+}
+
+/**
+ * @brief Moving window sum and count of non-NAN values along time with constant cost per step
+ *
+ * Input and output buffers store np pixels per time slice contiguously, i.e., windows of all pixels are moved
+ * at once. Windows are truncated at the borders of the input.
+ * @param in input buffer with nt time slices
+ * @param nt number of time slices of the input
+ * @param np number of pixels per time slice
+ * @param l number of time slices before the center of the window
+ * @param r number of time slices after the center of the window
+ * @param tb first time slice of the output, relative to the input
+ * @param te time slice after the last time slice of the output, relative to the input
+ * @param sum output buffer with (te - tb) * np elements for the sums
+ * @param count output buffer with (te - tb) * np elements for the number of non-NAN values
+ */
+inline void window_sum(const double *in, int32_t nt, uint64_t np, int32_t l, int32_t r, int32_t tb, int32_t te,
+                       double *sum, double *count) {
+    std::vector<double> s(np, 0), c(np, 0);
+    // initial window of the first output time slice, excluding its last element
+    for (int32_t t = std::max(0, tb - l); t < std::min(nt, tb + r); ++t) {
+        const double *v = in + uint64_t(t) * np;
+        for (uint64_t p = 0; p < np; ++p) {
+            bool valid = !std::isnan(v[p]);
+            s[p] += valid ? v[p] : 0;
+            c[p] += valid;
+        }
+    }
+    for (int32_t t = tb; t < te; ++t) {
+        int32_t t_add = t + r;
+        int32_t t_rem = t - l - 1;
+        if (t_add < nt) {
+            const double *v = in + uint64_t(t_add) * np;
+            for (uint64_t p = 0; p < np; ++p) {
+                bool valid = !std::isnan(v[p]);
+                s[p] += valid ? v[p] : 0;
+                c[p] += valid;
+            }
+        }
+        if (t > tb && t_rem >= 0) {
+            const double *v = in + uint64_t(t_rem) * np;
+            for (uint64_t p = 0; p < np; ++p) {
+                bool valid = !std::isnan(v[p]);
+                s[p] -= valid ? v[p] : 0;
+                c[p] -= valid;
+            }
+        }
+        std::copy(s.begin(), s.end(), sum + uint64_t(t - tb) * np);
+        std::copy(c.begin(), c.end(), count + uint64_t(t - tb) * np);
+    }
+}
+
+/**
+ * @brief Moving window minimum or maximum along time using a monotonic queue per pixel
+ *
+ * Each time slice enters and leaves the queue of a pixel at most once, i.e., the cost per step does not depend on
+ * the window size. NAN values are ignored, the result is NAN if a window contains no valid values.
+ * Arguments are the same as for window_sum().
+ * @tparam MAX true for maximum, false for minimum
+ */
+template <bool MAX>
+inline void window_extremum(const double *in, int32_t nt, uint64_t np, int32_t l, int32_t r, int32_t tb, int32_t te,
+                            double *out) {
+    std::vector<int32_t> queue(nt);
+    for (uint64_t p = 0; p < np; ++p) {
+        int32_t head = 0, tail = 0;  // queue elements are queue[head], ..., queue[tail - 1]
+        int32_t t_next = std::max(0, tb - l);
+        for (int32_t t = tb; t < te; ++t) {
+            for (; t_next <= std::min(nt - 1, t + r); ++t_next) {
+                double v = in[uint64_t(t_next) * np + p];
+                if (std::isnan(v)) continue;
+                while (tail > head && (MAX ? in[uint64_t(queue[tail - 1]) * np + p] <= v : in[uint64_t(queue[tail - 1]) * np + p] >= v)) {
+                    --tail;
+                }
+                queue[tail++] = t_next;
+            }
+            while (tail > head && queue[head] < t - l) {
+                ++head;
+            }
+            out[uint64_t(t - tb) * np + p] = (tail > head) ? in[uint64_t(queue[head]) * np + p] : NAN;
+        }
+    }
+}
+
+/**
+ * @brief Apply a convolution kernel along time
+ *
+ * Computes out[t] = sum_k kernel[k] * in[t - l + k] for all pixels. The result is NAN if the window exceeds the
+ * input or contains NAN values. Arguments are the same as for window_sum(), the kernel must have l + r + 1 elements.
+ * Short kernels are applied directly, vectorized over pixels. For kernels with more than fft_min_size elements, series
+ * are convolved in the frequency domain with cost O(n log n) per pixel, independent of the kernel size.
+ */
+inline void window_kernel(const double *in, int32_t nt, uint64_t np, const std::vector<double> &kernel, int32_t l,
+                          int32_t r, int32_t tb, int32_t te, double *out, uint32_t fft_min_size = 32) {
+    uint64_t nout = uint64_t(te - tb) * np;
+    if (kernel.size() <= fft_min_size) {
+        std::fill(out, out + nout, 0.0);
+        for (int32_t t = tb; t < te; ++t) {
+            double *o = out + uint64_t(t - tb) * np;
+            if (t - l < 0 || t + r >= nt) {
+                std::fill(o, o + np, NAN);
+                continue;
+            }
+            for (uint32_t k = 0; k < kernel.size(); ++k) {
+                const double *v = in + uint64_t(t - l + k) * np;
+                for (uint64_t p = 0; p < np; ++p) {
+                    o[p] += kernel[k] * v[p];  // NAN values propagate
+                }
+            }
+        }
+        return;
+    }
+
+    // number of NAN values per window, computed with a moving sum
+    std::vector<double> nan_count(nout), dummy(nout);
+    {
+        std::vector<double> isnan_buf(uint64_t(nt) * np);
+        for (uint64_t i = 0; i < isnan_buf.size(); ++i) {
+            isnan_buf[i] = std::isnan(in[i]);
+        }
+        window_sum(isnan_buf.data(), nt, np, l, r, tb, te, nan_count.data(), dummy.data());
+    }
+
+    uint64_t nfft = 1;
+    while (nfft < uint64_t(nt) + kernel.size() - 1) nfft <<= 1;
+    std::vector<std::complex<double>> kf(nfft, 0.0);
+    for (uint32_t k = 0; k < kernel.size(); ++k) {
+        kf[k] = kernel[kernel.size() - 1 - k];  // reversed kernel, correlation as convolution
+    }
+    fft(kf, false);
+
+    std::vector<std::complex<double>> xf(nfft);
+    for (uint64_t p = 0; p < np; ++p) {
+        std::fill(xf.begin(), xf.end(), 0.0);
+        for (int32_t t = 0; t < nt; ++t) {
+            double v = in[uint64_t(t) * np + p];
+            xf[t] = std::isnan(v) ? 0.0 : v;
+        }
+        fft(xf, false);
+        for (uint64_t i = 0; i < nfft; ++i) {
+            xf[i] *= kf[i];
+        }
+        fft(xf, true);
+        for (int32_t t = tb; t < te; ++t) {
+            uint64_t io = uint64_t(t - tb) * np + p;
+            bool valid = (t - l >= 0) && (t + r < nt) && nan_count[io] == 0;
+            out[io] = valid ? xf[t + r].real() : NAN;
+        }
+    }
+}
+
+/**
+ * @brief Carry the last valid value and its time index forward along time
+ *
+ * Buffers store np pixels per time slice contiguously, all pixels are processed at once for each time slice.
+ * @param in input buffer with nt time slices
+ * @param nt number of time slices
+ * @param np number of pixels per time slice
+ * @param t_offset global time index of the first time slice
+ * @param state_v last valid value per pixel (NAN if none), updated in place
+ * @param state_t global time index of the last valid value per pixel, updated in place
+ * @param out_v output buffer with nt * np elements for the last valid values at or before each cell, may be NULL
+ * @param out_t output buffer with nt * np elements for the corresponding time indexes, may be NULL
+ */
+inline void fill_scan_forward(const double *in, int32_t nt, uint64_t np, int32_t t_offset, double *state_v,
+                              double *state_t, double *out_v, double *out_t) {
+    for (int32_t t = 0; t < nt; ++t) {
+        const double *v = in + uint64_t(t) * np;
+        double tg = t_offset + t;
+        for (uint64_t p = 0; p < np; ++p) {
+            bool valid = !std::isnan(v[p]);
+            state_v[p] = valid ? v[p] : state_v[p];
+            state_t[p] = valid ? tg : state_t[p];
+        }
+        if (out_v) std::copy(state_v, state_v + np, out_v + uint64_t(t) * np);
+        if (out_t) std::copy(state_t, state_t + np, out_t + uint64_t(t) * np);
+    }
+}
+
+/**
+ * @brief Carry the next valid value and its time index backward along time
+ *
+ * Same as fill_scan_forward() but processes time slices in reverse order.
+ */
+inline void fill_scan_backward(const double *in, int32_t nt, uint64_t np, int32_t t_offset, double *state_v,
+                               double *state_t, double *out_v, double *out_t) {
+    for (int32_t t = nt - 1; t >= 0; --t) {
+        const double *v = in + uint64_t(t) * np;
+        double tg = t_offset + t;
+        for (uint64_t p = 0; p < np; ++p) {
+            bool valid = !std::isnan(v[p]);
+            state_v[p] = valid ? v[p] : state_v[p];
+            state_t[p] = valid ? tg : state_t[p];
+        }
+        if (out_v) std::copy(state_v, state_v + np, out_v + uint64_t(t) * np);
+        if (out_t) std::copy(state_t, state_t + np, out_t + uint64_t(t) * np);
+    }
+}
+
+}  // namespace kernels
+}  // namespace gdalcubes
+
+#endif  //KERNELS_H
@@ -0,0 +1,97 @@
+
+#include "lut_mask.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace gdalcubes {
+
+std::atomic<uint64_t> lut_mask::_images(0);
+std::atomic<uint64_t> lut_mask::_masked_images(0);
+std::atomic<uint64_t> lut_mask::_pixels(0);
+std::atomic<uint64_t> lut_mask::_masked_pixels(0);
+
+std::shared_ptr<lut_mask> lut_mask::from_values(std::unordered_set<double> mask_values, bool invert, std::vector<uint8_t> bits) {
+    return std::make_shared<lut_mask>([mask_values](double v) { return mask_values.count(v) == 1; }, invert, bits,
+                                      std::make_shared<value_mask>(mask_values, invert, bits));
+}
+
+std::shared_ptr<lut_mask> lut_mask::from_range(double min, double max, bool invert, std::vector<uint8_t> bits) {
+    return std::make_shared<lut_mask>([min, max](double v) { return v >= min && v <= max; }, invert, bits,
+                                      std::make_shared<range_mask>(min, max, invert, bits));
+}
+
+lut_mask::lut_mask(std::function<bool(double)> match, bool invert, std::vector<uint8_t> bits, std::shared_ptr<image_mask> equivalent)
+    : _match(match), _invert(invert), _bitmask(0xFFFFFFFF), _lut(65536), _equivalent(equivalent) {
+    if (!bits.empty()) {
+        _bitmask = 0;
+        for (uint16_t i = 0; i < bits.size(); ++i) {
+            if (bits[i] >= 32) {
+                throw std::string("ERROR in lut_mask::lut_mask(): Bit index " + std::to_string(bits[i]) + " is out of range");
+            }
+            _bitmask |= uint32_t(1) << bits[i];
+        }
+    }
+    for (uint32_t v = 0; v < 65536; ++v) {
+        _lut[v] = _match(double(v & _bitmask)) != invert;
+    }
+}
+
+void lut_mask::apply(double *mask_buf, double *img_buf, uint32_t nb, uint32_t ny, uint32_t nx) {
+    uint64_t n = uint64_t(ny) * uint64_t(nx);
+    std::vector<uint8_t> flag(n);
+    for (uint64_t i = 0; i < n; ++i) {
+        double m = mask_buf[i];
+        bool in_table = m >= 0 && m <= 65535;  // false for NaN
+        uint32_t v = in_table ? uint32_t(m) : 0;
+        in_table = in_table && double(v) == m;
+        flag[i] = in_table ? _lut[v] : 2;
+    }
+    uint64_t nmasked = 0;
+    for (uint64_t i = 0; i < n; ++i) {
+        if (flag[i] == 2) {
+            // rare: negative, fractional, large, or NaN mask values
+            double m = mask_buf[i];
+            bool match = false;
+            if (!std::isnan(m)) {
+                match = (_bitmask == 0xFFFFFFFF) ? _match(m) : _match(double(uint32_t(int64_t(m)) & _bitmask));
+            }
+            flag[i] = match != _invert;
+        }
+        nmasked += flag[i];
+    }
+
+    if (nmasked == n) {
+        std::fill(img_buf, img_buf + uint64_t(nb) * n, NAN);
+    } else if (nmasked > 0) {
+        for (uint32_t ib = 0; ib < nb; ++ib) {
+            double *b = img_buf + uint64_t(ib) * n;
+            for (uint64_t i = 0; i < n; ++i) {
+                b[i] = flag[i] ? NAN : b[i];
+            }
+        }
+    }
+
+    ++_images;
+    _masked_images += (nmasked == n);
+    _pixels += n;
+    _masked_pixels += nmasked;
+}
+
+lut_mask::statistics lut_mask::stats(bool reset) {
+    statistics s;
+    if (reset) {
+        s.images = _images.exchange(0);
+        s.masked_images = _masked_images.exchange(0);
+        s.pixels = _pixels.exchange(0);
+        s.masked_pixels = _masked_pixels.exchange(0);
+    } else {
+        s.images = _images;
+        s.masked_images = _masked_images;
+        s.pixels = _pixels;
+        s.masked_pixels = _masked_pixels;
+    }
+    return s;
+}
+
+}  // namespace gdalcubes
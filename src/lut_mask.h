@@ -0,0 +1,84 @@
+
+#ifndef LUT_MASK_H
+#define LUT_MASK_H
+
+#include "gdalcubes/src/gdalcubes.h"
+
+#include <atomic>
+#include <functional>
+#include <unordered_set>
+
+namespace gdalcubes {
+
+/**
+ * @brief Image mask for integer mask values (e.g. quality bands) based on a lookup table
+ *
+ * Results are identical to value_mask or range_mask but instead of evaluating the mask per pixel, integer mask values in
+ * [0, 65535] are looked up in a table of 65536 flags, which already includes the extracted bits and the inversion. Masked
+ * pixels are flagged in a first pass and all image bands are updated in a second, branch-free pass. Mask values
+ * that are not representable in the table are evaluated directly. Images where all pixels are masked are
+ * filled with NAN instead of updating values pixel by pixel. Band values have already been read by the library when the
+ * mask is applied, i.e. the counters of statistics only estimate how many reads could be saved.
+ *
+ * The JSON description is the one of the equivalent library mask, i.e. recreated cubes use the library implementation.
+ */
+class lut_mask : public image_mask {
+   public:
+    /**
+     * @brief Counters of applied masks, accumulated over all lut_mask instances
+     */
+    struct statistics {
+        uint64_t images;
+        uint64_t masked_images;
+        uint64_t pixels;
+        uint64_t masked_pixels;
+    };
+
+    /**
+     * @brief Create a lookup table mask for a set of values
+     * @param mask_values set of mask values, after extracting bits
+     * @param invert mask pixels whose value is not contained in mask_values
+     * @param bits zero-based indexes of bits to extract with a bitwise AND before the lookup, all bits if empty
+     */
+    static std::shared_ptr<lut_mask> from_values(std::unordered_set<double> mask_values, bool invert = false, std::vector<uint8_t> bits = {});
+
+    /**
+     * @brief Create a lookup table mask for a range of values
+     * @param min smallest mask value, after extracting bits
+     * @param max largest mask value, after extracting bits
+     * @param invert mask pixels whose value is not in [min, max]
+     * @param bits zero-based indexes of bits to extract with a bitwise AND before the comparison, all bits if empty
+     */
+    static std::shared_ptr<lut_mask> from_range(double min, double max, bool invert = false, std::vector<uint8_t> bits = {});
+
+   public:
+    lut_mask(std::function<bool(double)> match, bool invert, std::vector<uint8_t> bits, std::shared_ptr<image_mask> equivalent);
+
+    void apply(double *mask_buf, double *img_buf, uint32_t nb, uint32_t ny, uint32_t nx) override;
+
+    nlohmann::json as_json() override {
+        return _equivalent->as_json();
+    }
+
+    /**
+     * @brief Get counters of all masks applied since the last reset
+     * @param reset set all counters to zero afterwards
+     */
+    static statistics stats(bool reset = false);
+
+   private:
+    std::function<bool(double)> _match;
+    bool _invert;
+    uint32_t _bitmask;
+    std::vector<uint8_t> _lut;
+    std::shared_ptr<image_mask> _equivalent;
+
+    static std::atomic<uint64_t> _images;
+    static std::atomic<uint64_t> _masked_images;
+    static std::atomic<uint64_t> _pixels;
+    static std::atomic<uint64_t> _masked_pixels;
+};
+
+}  // namespace gdalcubes
+
+#endif  //LUT_MASK_H
@@ -0,0 +1,106 @@
+
+#ifndef PARALLEL_FOR_H
+#define PARALLEL_FOR_H
+
+#include "gdalcubes/src/gdalcubes.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <mutex>
+
+namespace gdalcubes {
+
+/**
+ * @brief A data cube without any data whose chunks represent the iterations of a loop
+ *
+ * Chunk processors only iterate over chunks of data cubes. This cube has one chunk per iteration, such that arbitrary
+ * loops can be run by chunk processors, i.e. with the configured number of threads and interruptible by the user.
+ */
+class index_cube : public cube {
+   public:
+    /**
+     * @brief Create a cube with n chunks
+     * @param n number of chunks, i.e., loop iterations
+     */
+    index_cube(uint32_t n) : cube(make_st_reference(n)) {
+        _chunk_size[0] = 1;
+        _chunk_size[1] = 1;
+        _chunk_size[2] = 1;
+    }
+
+   public:
+    ~index_cube() {}
+
+    std::shared_ptr<chunk_data> read_chunk(chunkid_t id) override {
+        return std::make_shared<chunk_data>();
+    }
+
+    nlohmann::json make_constructible_json() override {
+        throw std::string("ERROR in index_cube::make_constructible_json(): Index cubes cannot be serialized");
+    }
+
+   private:
+    static std::shared_ptr<cube_st_reference> make_st_reference(uint32_t n) {
+        std::shared_ptr<cube_view> v = std::make_shared<cube_view>();
+        v->left() = 0;
+        v->right() = std::max(uint32_t(1), n);
+        v->bottom() = 0;
+        v->top() = 1;
+        v->nx() = n;
+        v->ny() = 1;
+        v->srs() = "EPSG:4326";
+        v->dt(duration::from_string("P1D"));
+        v->t0() = datetime::from_string("2000-01-01");
+        v->t1() = v->t0();
+        v->t0().unit() = v->dt().dt_unit;
+        v->t1().unit() = v->dt().dt_unit;
+        return v;
+    }
+
+    void set_st_reference(std::shared_ptr<cube_st_reference> stref) override {
+        throw std::string("ERROR in index_cube::set_st_reference(): The spatiotemporal reference of index cubes cannot be changed");
+    }
+};
+
+/**
+ * @brief Call a function for all indexes 0, ..., n - 1 in parallel using a chunk processor
+ *
+ * Chunk processors log and skip failed chunks. Instead, the first exception thrown by f is passed to the caller
+ * after all threads have finished, remaining iterations are skipped.
+ *
+ * @param n number of iterations
+ * @param f function to be called for each index, possibly concurrently
+ * @param p chunk processor, if nullptr, the default chunk processor will be used; the default chunk processor of the R package
+ * checks for user interrupts and must only be used from the main thread
+ */
+inline void parallel_for(uint32_t n, std::function<void(uint32_t)> f, std::shared_ptr<chunk_processor> p = nullptr) {
+    if (n == 0) return;
+    if (!p) {
+        p = config::instance()->get_default_chunk_processor();
+    }
+    std::mutex m_error;
+    std::string error;
+    std::atomic<bool> failed(false);
+    p->apply(std::make_shared<index_cube>(n), [&f, &m_error, &error, &failed](chunkid_t id, std::shared_ptr<chunk_data> dat, std::mutex &m) {
+        if (failed) return;
+        try {
+            f(id);
+        } catch (std::string s) {
+            std::lock_guard<std::mutex> lock(m_error);
+            if (!failed) error = s;
+            failed = true;
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(m_error);
+            if (!failed) error = "unexpected exception in parallel_for()";
+            failed = true;
+        }
+    });
+    if (failed) {
+        throw error;
+    }
+}
+
+}  // namespace gdalcubes
+
+#endif  //PARALLEL_FOR_H
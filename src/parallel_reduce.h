@@ -0,0 +1,101 @@
+
+#ifndef PARALLEL_REDUCE_H
+#define PARALLEL_REDUCE_H
+
+#include "gdalcubes/src/gdalcubes.h"
+#include "incremental_reducer.h"
+
+#include <functional>
+#include <thread>
+
+namespace gdalcubes {
+
+/**
+ * @brief Partial states of several incremental reducers, one per output band
+ */
+typedef std::vector<std::shared_ptr<incremental_reducer>> reducer_states;
+
+/**
+ * @brief Derive the number of threads to use within a single output chunk
+ *
+ * Additional threads are only used if the output cube has fewer chunks than threads of the default chunk processor.
+ * @param count_out_chunks number of chunks of the output cube
+ * @param count_in_chunks number of input chunks contributing to one output chunk
+ */
+inline uint32_t parallel_reduce_threads(uint32_t count_out_chunks, uint32_t count_in_chunks) {
+    uint32_t nthreads = config::instance()->get_default_chunk_processor()->max_threads() / std::max(uint32_t(1), count_out_chunks);
+    return std::max(uint32_t(1), std::min(nthreads, count_in_chunks));
+}
+
+/**
+ * @brief Reduce several input chunks into one set of reducer states using thread-local partial states
+ *
+ * Each thread processes every nthreads-th input chunk and updates its own states without any locking.
+ * Afterwards, partial states are merged pairwise in a parallel tree reduction with log2(nthreads) levels.
+ *
+ * @param count_in_chunks number of input chunks
+ * @param nthreads number of threads
+ * @param init function creating and initializing empty states
+ * @param process function updating the given states with the k-th input chunk
+ * @return merged states
+ */
+inline reducer_states parallel_reduce(uint32_t count_in_chunks, uint32_t nthreads,
+                                      std::function<reducer_states()> init,
+                                      std::function<void(uint32_t, reducer_states &)> process) {
+    nthreads = std::max(uint32_t(1), nthreads);
+    std::vector<reducer_states> partial(nthreads);
+    for (uint32_t it = 0; it < nthreads; ++it) {
+        partial[it] = init();
+    }
+
+    std::vector<std::string> errors(nthreads);
+    auto worker = [count_in_chunks, nthreads, &partial, &process, &errors](uint32_t it) {
+        try {
+            for (uint32_t k = it; k < count_in_chunks; k += nthreads) {
+                process(k, partial[it]);
+            }
+        } catch (std::string s) {
+            errors[it] = s;
+        } catch (...) {
+            errors[it] = "unexpected exception in parallel_reduce()";
+        }
+    };
+
+    if (nthreads == 1) {
+        worker(0);
+    } else {
+        std::vector<std::thread> workers;
+        for (uint32_t it = 0; it < nthreads; ++it) {
+            workers.push_back(std::thread(worker, it));
+        }
+        for (uint32_t it = 0; it < nthreads; ++it) {
+            workers[it].join();
+        }
+    }
+    for (uint32_t it = 0; it < nthreads; ++it) {
+        if (!errors[it].empty()) {
+            throw errors[it];
+        }
+    }
+
+    // tree reduction, at each level, states i and i + step are merged into state i
+    for (uint32_t step = 1; step < nthreads; step *= 2) {
+        std::vector<std::thread> mergers;
+        for (uint32_t i = 0; i + step < nthreads; i += 2 * step) {
+            mergers.push_back(std::thread([&partial, i, step]() {
+                for (uint16_t ir = 0; ir < partial[i].size(); ++ir) {
+                    partial[i][ir]->merge(partial[i + step][ir].get());
+                }
+                partial[i + step].clear();
+            }));
+        }
+        for (uint32_t im = 0; im < mergers.size(); ++im) {
+            mergers[im].join();
+        }
+    }
+    return partial[0];
+}
+
+}  // namespace gdalcubes
+
+#endif  //PARALLEL_REDUCE_H
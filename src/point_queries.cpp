@@ -0,0 +1,214 @@
+
+#include "point_queries.h"
+
+#include "calendar.h"
+#include "parallel_for.h"
+
+#include <gdal_priv.h>
+#include <ogr_spatialref.h>
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+
+namespace gdalcubes {
+
+namespace {
+
+// parse "YYYY-MM-DDTHH:MM:SS" as produced by datetime::to_string(datetime_unit::SECOND)
+double parse_epoch_seconds(std::string s) {
+    int y = 0, m = 1, d = 1, hh = 0, mm = 0, ss = 0;
+    if (std::sscanf(s.c_str(), "%d-%d-%dT%d:%d:%d", &y, &m, &d, &hh, &mm, &ss) < 1) {
+        return NAN;
+    }
+    return double(calendar::days_from_civil(y, m, d)) * 86400.0 + hh * 3600.0 + mm * 60.0 + ss;
+}
+
+}  // namespace
+
+std::vector<double> point_queries::epoch_seconds(std::vector<std::string> t) {
+    std::vector<double> out(t.size(), NAN);
+    for (uint64_t i = 0; i < t.size(); ++i) {
+        datetime dt = datetime::from_string(t[i]);
+        out[i] = parse_epoch_seconds(dt.to_string(datetime_unit::SECOND));
+    }
+    return out;
+}
+
+void point_queries::cell_xy(std::shared_ptr<cube> c, std::vector<double> &px, std::vector<double> &py, std::string srs,
+                            std::vector<int32_t> &ix, std::vector<int32_t> &iy) {
+    if (px.size() != py.size()) {
+        throw std::string("ERROR in point_queries::cell_xy(): Point coordinate vectors must have identical length");
+    }
+    auto st = c->st_reference();
+    std::vector<double> x(px), y(py);
+
+    OGRSpatialReference srs_in;
+    srs_in.SetFromUserInput(srs.c_str());
+    OGRSpatialReference srs_out = st->srs_ogr();
+#if GDAL_VERSION_MAJOR >= 3
+    srs_in.SetAxisMappingStrategy(OAMS_TRADITIONAL_GIS_ORDER);
+    srs_out.SetAxisMappingStrategy(OAMS_TRADITIONAL_GIS_ORDER);
+#endif
+    if (!srs_in.IsSame(&srs_out)) {
+        OGRCoordinateTransformation *trans = OGRCreateCoordinateTransformation(&srs_in, &srs_out);
+        if (trans == nullptr) {
+            throw std::string("ERROR in point_queries::cell_xy(): Cannot transform point coordinates to the data cube's spatial reference system");
+        }
+        // transform all points at once, in batches to respect the int argument of Transform()
+        for (uint64_t i = 0; i < x.size(); i += INT_MAX) {
+            int n = int(std::min(uint64_t(INT_MAX), x.size() - i));
+            trans->Transform(n, x.data() + i, y.data() + i);
+        }
+        OCTDestroyCoordinateTransformation(trans);
+    }
+
+    ix.resize(x.size());
+    iy.resize(x.size());
+    for (uint64_t i = 0; i < x.size(); ++i) {
+        double cx = std::floor((x[i] - st->left()) / st->dx());
+        double cy = std::floor((st->top() - y[i]) / st->dy());
+        bool inside = cx >= 0 && cx < st->nx() && cy >= 0 && cy < st->ny();
+        ix[i] = inside ? int32_t(cx) : -1;
+        iy[i] = inside ? int32_t(cy) : -1;
+    }
+}
+
+std::vector<int32_t> point_queries::cell_t(std::shared_ptr<cube> c, std::vector<double> &pt) {
+    auto st = c->st_reference();
+    std::vector<int32_t> it(pt.size(), -1);
+    double t0 = parse_epoch_seconds(st->t0().to_string(datetime_unit::SECOND));
+    datetime_unit u = st->dt().dt_unit;
+    int32_t interval = st->dt().dt_interval;
+
+    if (u == datetime_unit::YEAR || u == datetime_unit::MONTH) {
+        // calendar arithmetic, time slices start at the same day and time of month as t0
+        int64_t y0, m0, d0;
+        int64_t days0 = int64_t(std::floor(t0 / 86400.0));
+        calendar::civil_from_days(days0, y0, m0, d0);
+        double offset0 = (d0 - 1) * 86400.0 + (t0 - days0 * 86400.0);
+        int32_t months_per_step = interval * (u == datetime_unit::YEAR ? 12 : 1);
+        for (uint64_t i = 0; i < pt.size(); ++i) {
+            if (std::isnan(pt[i])) continue;
+            int64_t y, m, d;
+            int64_t days = int64_t(std::floor(pt[i] / 86400.0));
+            calendar::civil_from_days(days, y, m, d);
+            double offset = (d - 1) * 86400.0 + (pt[i] - days * 86400.0);
+            int64_t months = (y - y0) * 12 + (m - m0) - (offset < offset0 ? 1 : 0);
+            int64_t idx = int64_t(std::floor(double(months) / months_per_step));
+            it[i] = (idx >= 0 && idx < st->nt()) ? int32_t(idx) : -1;
+        }
+        return it;
+    }
+
+    double step = interval;
+    if (u == datetime_unit::WEEK) step *= 604800.0;
+    else if (u == datetime_unit::DAY) step *= 86400.0;
+    else if (u == datetime_unit::HOUR) step *= 3600.0;
+    else if (u == datetime_unit::MINUTE) step *= 60.0;
+    for (uint64_t i = 0; i < pt.size(); ++i) {
+        double idx = std::floor((pt[i] - t0) / step);  // NAN if pt[i] is NAN
+        it[i] = (idx >= 0 && idx < st->nt()) ? int32_t(idx) : -1;
+    }
+    return it;
+}
+
+void point_queries::for_each_group(std::vector<int64_t> &keys, std::function<void(int64_t, std::vector<uint32_t> &)> f) {
+    std::vector<uint32_t> order;
+    order.reserve(keys.size());
+    for (uint32_t i = 0; i < keys.size(); ++i) {
+        if (keys[i] >= 0) order.push_back(i);
+    }
+    std::sort(order.begin(), order.end(), [&keys](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+
+    std::vector<uint64_t> group_start;
+    for (uint64_t i = 0; i < order.size(); ++i) {
+        if (i == 0 || keys[order[i]] != keys[order[i - 1]]) group_start.push_back(i);
+    }
+    group_start.push_back(order.size());
+    uint64_t ngroups = group_start.size() - 1;
+
+    std::shared_ptr<progress> prg = config::instance()->get_default_progress_bar()->get();
+    prg->set(0);
+
+    parallel_for(uint32_t(ngroups), [&](uint32_t ig) {
+        std::vector<uint32_t> points(order.begin() + group_start[ig], order.begin() + group_start[ig + 1]);
+        f(keys[points[0]], points);
+        prg->increment(1.0 / double(ngroups));
+    });
+    prg->finalize();
+}
+
+std::vector<std::vector<double>> point_queries::query_points(std::shared_ptr<cube> c, std::vector<double> &px, std::vector<double> &py,
+                                                             std::vector<double> &pt, std::string srs) {
+    if (px.size() != pt.size()) {
+        throw std::string("ERROR in point_queries::query_points(): Point coordinate vectors must have identical length");
+    }
+    std::vector<int32_t> ix, iy;
+    cell_xy(c, px, py, srs, ix, iy);
+    std::vector<int32_t> it = cell_t(c, pt);
+
+    uint32_t cs_t = c->chunk_size()[0], cs_y = c->chunk_size()[1], cs_x = c->chunk_size()[2];
+    int64_t ncx = c->count_chunks_x(), ncy = c->count_chunks_y();
+    std::vector<int64_t> chunk(px.size(), -1);
+    for (uint64_t i = 0; i < px.size(); ++i) {
+        if (ix[i] < 0 || iy[i] < 0 || it[i] < 0) continue;
+        chunk[i] = (it[i] / cs_t) * ncy * ncx + (iy[i] / cs_y) * ncx + (ix[i] / cs_x);
+    }
+
+    std::vector<std::vector<double>> out(c->bands().count(), std::vector<double>(px.size(), NAN));
+    for_each_group(chunk, [c, &out, &ix, &iy, &it](int64_t id, std::vector<uint32_t> &points) {
+        std::shared_ptr<chunk_data> dat = c->read_chunk(id);
+        if (dat->empty()) return;
+        bounds_nd<uint32_t, 3> lim = c->chunk_limits(id);
+        uint64_t csize_t = dat->size()[1], csize_y = dat->size()[2], csize_x = dat->size()[3];
+        for (uint32_t ip = 0; ip < points.size(); ++ip) {
+            uint32_t i = points[ip];
+            uint64_t offset = ((uint64_t(it[i] - lim.low[0])) * csize_y + (iy[i] - lim.low[1])) * csize_x + (ix[i] - lim.low[2]);
+            for (uint16_t ib = 0; ib < dat->size()[0]; ++ib) {
+                out[ib][i] = ((double *)dat->buf())[ib * csize_t * csize_y * csize_x + offset];
+            }
+        }
+    });
+    return out;
+}
+
+std::vector<double> point_queries::query_timeseries(std::shared_ptr<cube> c, std::vector<double> &px, std::vector<double> &py, std::string srs) {
+    std::vector<int32_t> ix, iy;
+    cell_xy(c, px, py, srs, ix, iy);
+
+    uint32_t cs_y = c->chunk_size()[1], cs_x = c->chunk_size()[2];
+    int64_t ncx = c->count_chunks_x(), ncy = c->count_chunks_y();
+    std::vector<int64_t> chunk_xy(px.size(), -1);
+    for (uint64_t i = 0; i < px.size(); ++i) {
+        if (ix[i] < 0 || iy[i] < 0) continue;
+        chunk_xy[i] = (iy[i] / cs_y) * ncx + (ix[i] / cs_x);
+    }
+
+    uint64_t np = px.size();
+    uint64_t nt = c->st_reference()->nt();
+    uint16_t nb = c->bands().count();
+    std::vector<double> out(np * nt * nb, NAN);
+    for_each_group(chunk_xy, [c, &out, &ix, &iy, np, nt, ncx, ncy](int64_t id_xy, std::vector<uint32_t> &points) {
+        for (int64_t ct = 0; ct < int64_t(c->count_chunks_t()); ++ct) {
+            int64_t id = ct * ncy * ncx + id_xy;
+            std::shared_ptr<chunk_data> dat = c->read_chunk(id);
+            if (dat->empty()) continue;
+            bounds_nd<uint32_t, 3> lim = c->chunk_limits(id);
+            uint64_t csize_t = dat->size()[1], csize_y = dat->size()[2], csize_x = dat->size()[3];
+            for (uint32_t ip = 0; ip < points.size(); ++ip) {
+                uint32_t i = points[ip];
+                uint64_t offset = uint64_t(iy[i] - lim.low[1]) * csize_x + (ix[i] - lim.low[2]);
+                for (uint16_t ib = 0; ib < dat->size()[0]; ++ib) {
+                    for (uint64_t it = 0; it < csize_t; ++it) {
+                        out[(ib * nt + lim.low[0] + it) * np + i] = ((double *)dat->buf())[((ib * csize_t) + it) * csize_y * csize_x + offset];
+                    }
+                }
+            }
+        }
+    });
+    return out;
+}
+
+}  // namespace gdalcubes
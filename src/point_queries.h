@@ -0,0 +1,77 @@
+
+#ifndef POINT_QUERIES_H
+#define POINT_QUERIES_H
+
+#include "gdalcubes/src/gdalcubes.h"
+
+#include <functional>
+
+namespace gdalcubes {
+
+/**
+ * @brief Batched queries of data cube values at large sets of points
+ *
+ * In contrast to vector_queries::query_points(), point coordinates are transformed in a single batch, query times are
+ * given as numbers, and points are binned by chunks such that each chunk is read only once and all of its points are
+ * processed together. Chunks are processed in parallel by the number of threads of the default chunk processor.
+ */
+class point_queries {
+   public:
+    /**
+     * @brief Convert date / time strings as understood by datetime::from_string() to seconds since 1970-01-01 00:00:00
+     * @param t vector of date / time strings
+     * @return vector of seconds, NAN for strings that cannot be parsed
+     */
+    static std::vector<double> epoch_seconds(std::vector<std::string> t);
+
+    /**
+     * @brief Query data cube values at irregular spatiotemporal points
+     * @param c data cube
+     * @param px x coordinates of the points
+     * @param py y coordinates of the points
+     * @param pt time of the points as seconds since 1970-01-01 00:00:00
+     * @param srs spatial reference system of the point coordinates
+     * @return columnar result with one vector per band and one element per point, NAN for points outside of the cube
+     */
+    static std::vector<std::vector<double>> query_points(std::shared_ptr<cube> c, std::vector<double> &px, std::vector<double> &py,
+                                                         std::vector<double> &pt, std::string srs);
+
+    /**
+     * @brief Extract complete time series of data cube values at spatial points
+     *
+     * Points are binned by spatial chunks; for each spatial chunk, all of its time chunks are read once and the
+     * time series of all points in that chunk are extracted together.
+     *
+     * @param c data cube
+     * @param px x coordinates of the points
+     * @param py y coordinates of the points
+     * @param srs spatial reference system of the point coordinates
+     * @return array of size points x time x bands with points varying fastest, NAN for points outside of the cube
+     */
+    static std::vector<double> query_timeseries(std::shared_ptr<cube> c, std::vector<double> &px, std::vector<double> &py, std::string srs);
+
+   protected:
+    /**
+     * @brief Compute integer x and y cell indexes of points, -1 for points outside of the cube
+     */
+    static void cell_xy(std::shared_ptr<cube> c, std::vector<double> &px, std::vector<double> &py, std::string srs,
+                        std::vector<int32_t> &ix, std::vector<int32_t> &iy);
+
+    /**
+     * @brief Compute integer time indexes of points given in seconds since 1970-01-01, -1 for points outside of the cube
+     */
+    static std::vector<int32_t> cell_t(std::shared_ptr<cube> c, std::vector<double> &pt);
+
+    /**
+     * @brief Sort points by keys (e.g. chunk ids) and call a function for each group of points with the same key in parallel
+     *
+     * Groups are processed by the default chunk processor (see parallel_for()), i.e. with the configured number of threads.
+     * @param keys key per point, points with negative keys are ignored
+     * @param f function receiving the key and the indexes of all points with this key
+     */
+    static void for_each_group(std::vector<int64_t> &keys, std::function<void(int64_t, std::vector<uint32_t> &)> f);
+};
+
+}  // namespace gdalcubes
+
+#endif  //POINT_QUERIES_H
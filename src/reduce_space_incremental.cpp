@@ -0,0 +1,94 @@
+
+#include "reduce_space_incremental.h"
+
+#include "parallel_reduce.h"
+
+#include <cstdlib>
+
+namespace gdalcubes {
+
+reduce_space_incremental_cube::reduce_space_incremental_cube(std::shared_ptr<cube> in, std::vector<std::pair<std::string, std::string>> reducer_bands, uint32_t approx_quantile_compression) : cube(std::make_shared<cube_st_reference>(*(in->st_reference()))), _in_cube(in), _reducer_bands(reducer_bands), _approx_quantile_compression(approx_quantile_compression) {
+    _st_ref->nx() = 1;
+    _st_ref->ny() = 1;
+    _chunk_size[0] = _in_cube->chunk_size()[0];
+    _chunk_size[1] = 1;
+    _chunk_size[2] = 1;
+
+    for (uint16_t i = 0; i < reducer_bands.size(); ++i) {
+        std::string reducerstr = std::get<0>(reducer_bands[i]);
+        std::string bandstr = std::get<1>(reducer_bands[i]);
+        if (!supports({reducer_bands[i]})) {
+            throw std::string("ERROR in reduce_space_incremental_cube::reduce_space_incremental_cube(): Unknown reducer given");
+        }
+        if (!in->bands().has(bandstr)) {
+            throw std::string("ERROR in reduce_space_incremental_cube::reduce_space_incremental_cube(): Input data cube has no band '" + bandstr + "'");
+        }
+        band b = in->bands().get(bandstr);
+        b.name = bandstr + "_" + reducerstr;
+        if (reducerstr == "count") {
+            b.scale = 1;
+            b.offset = 0;
+            b.unit = "";
+        }
+        _bands.add(b);
+    }
+}
+
+std::shared_ptr<chunk_data> reduce_space_incremental_cube::read_chunk(chunkid_t id) {
+    GCBS_TRACE("reduce_space_incremental_cube::read_chunk(" + std::to_string(id) + ")");
+    std::shared_ptr<chunk_data> out = std::make_shared<chunk_data>();
+    if (id < 0 || id >= count_chunks())
+        return out;  // chunk is outside of the view, we don't need to read anything.
+
+    coords_nd<uint32_t, 3> size_tyx = chunk_size(id);
+    coords_nd<uint32_t, 4> size_btyx = {uint32_t(_reducer_bands.size()), size_tyx[0], 1, 1};
+    uint32_t nt = size_tyx[0];
+
+    std::vector<uint16_t> band_idx;
+    for (uint16_t i = 0; i < _reducer_bands.size(); ++i) {
+        band_idx.push_back(_in_cube->bands().get_index(_reducer_bands[i].second));
+    }
+
+    // input chunks of the same time slices have ids id * nxy, id * nxy + 1, ..., (id + 1) * nxy - 1
+    uint32_t nchunks_xy = _in_cube->count_chunks_x() * _in_cube->count_chunks_y();
+
+    auto init_states = [this, nt]() {
+        reducer_states states;
+        for (uint16_t i = 0; i < _reducer_bands.size(); ++i) {
+            states.push_back(incremental_reducer::create(_reducer_bands[i].first, _approx_quantile_compression));
+            states.back()->init(nt);
+        }
+        return states;
+    };
+    auto process_chunk = [this, id, nchunks_xy, &band_idx](uint32_t cxy, reducer_states &states) {
+        std::shared_ptr<chunk_data> x = _in_cube->read_chunk(id * nchunks_xy + cxy);
+        if (x->empty()) return;
+        uint64_t nxy = uint64_t(x->size()[2]) * uint64_t(x->size()[3]);
+        for (uint16_t i = 0; i < _reducer_bands.size(); ++i) {
+            for (uint32_t t = 0; t < x->size()[1]; ++t) {
+                const double *v = ((double *)x->buf()) + (uint64_t(band_idx[i]) * x->size()[1] + t) * nxy;
+                states[i]->update_cell(t, v, nxy, 0);
+            }
+        }
+    };
+
+    // spatial chunks are reduced in parallel with thread-local partial states, followed by a tree reduction
+    reducer_states r = parallel_reduce(nchunks_xy, parallel_reduce_threads(count_chunks(), nchunks_xy), init_states, process_chunk);
+
+    out->size(size_btyx);
+    out->buf(std::calloc(size_btyx[0] * size_btyx[1] * size_btyx[2] * size_btyx[3], sizeof(double)));
+    for (uint16_t i = 0; i < _reducer_bands.size(); ++i) {
+        r[i]->finalize(((double *)out->buf()) + i * nt);
+    }
+    return out;
+}
+
+void reduce_space_incremental_cube::register_cube_type() {
+    cube_factory::instance()->register_cube_type("reduce_space_incremental", [](nlohmann::json& j) {
+        std::vector<std::pair<std::string, std::string>> reducer_bands = j["reducer_bands"].get<std::vector<std::pair<std::string, std::string>>>();
+        uint32_t compression = j.count("approx_quantile_compression") ? j["approx_quantile_compression"].get<uint32_t>() : 50;
+        return reduce_space_incremental_cube::create(cube_factory::instance()->create_from_json(j["in_cube"]), reducer_bands, compression);
+    });
+}
+
+}  // namespace gdalcubes
@@ -0,0 +1,91 @@
+
+#ifndef REDUCE_SPACE_INCREMENTAL_H
+#define REDUCE_SPACE_INCREMENTAL_H
+
+#include "gdalcubes/src/gdalcubes.h"
+#include "incremental_reducer.h"
+
+namespace gdalcubes {
+
+/**
+ * @brief A data cube that applies reducer functions over spatial slices, chunk by chunk
+ *
+ * Input chunks of the same time slices update per-time-slice partial states one after another, such that spatial
+ * slices never need to be kept in memory completely. This makes it possible to use sketch-based reducers such as
+ * approx_median with bounded memory.
+ *
+ * Since the result usually consists of only a few chunks, spatial chunks contributing to the same output chunk are
+ * processed by several threads with thread-local partial states that are combined in a tree reduction
+ * (see parallel_reduce()).
+ */
+class reduce_space_incremental_cube : public cube {
+   public:
+    /**
+     * @brief Create a data cube that applies incremental reducer functions over spatial slices
+     * @note This static creation method should preferably be used instead of the constructors as
+     * the constructors will not set connections between cubes properly.
+     * @param in input data cube
+     * @param reducer_bands vector of pairs (reducer, band name)
+     * @param approx_quantile_compression compression parameter of approximate quantile reducers
+     * @return a shared pointer to the created data cube instance
+     */
+    static std::shared_ptr<reduce_space_incremental_cube> create(std::shared_ptr<cube> in, std::vector<std::pair<std::string, std::string>> reducer_bands, uint32_t approx_quantile_compression = 50) {
+        std::shared_ptr<reduce_space_incremental_cube> out = std::make_shared<reduce_space_incremental_cube>(in, reducer_bands, approx_quantile_compression);
+        in->add_child_cube(out);
+        out->add_parent_cube(in);
+        return out;
+    }
+
+    /**
+     * @brief Check whether all reducers have an incremental implementation that can be applied over space
+     * @param reducer_bands vector of pairs (reducer, band name)
+     */
+    static bool supports(std::vector<std::pair<std::string, std::string>> reducer_bands) {
+        for (uint16_t i = 0; i < reducer_bands.size(); ++i) {
+            std::string r = reducer_bands[i].first;
+            if (r == "which_min" || r == "which_max" || !incremental_reducer::is_supported(r)) return false;
+        }
+        return true;
+    }
+
+   public:
+    reduce_space_incremental_cube(std::shared_ptr<cube> in, std::vector<std::pair<std::string, std::string>> reducer_bands, uint32_t approx_quantile_compression = 50);
+
+   public:
+    ~reduce_space_incremental_cube() {}
+
+    std::shared_ptr<chunk_data> read_chunk(chunkid_t id) override;
+
+    nlohmann::json make_constructible_json() override {
+        nlohmann::json out;
+        out["cube_type"] = "reduce_space_incremental";
+        out["reducer_bands"] = _reducer_bands;
+        out["approx_quantile_compression"] = _approx_quantile_compression;
+        out["in_cube"] = _in_cube->make_constructible_json();
+        return out;
+    }
+
+    /**
+     * @brief Register this cube type at the cube factory, such that it can be recreated from its JSON description
+     */
+    static void register_cube_type();
+
+   private:
+    std::shared_ptr<cube> _in_cube;
+    std::vector<std::pair<std::string, std::string>> _reducer_bands;
+    uint32_t _approx_quantile_compression;
+
+    void set_st_reference(std::shared_ptr<cube_st_reference> stref) override {
+        _st_ref->win() = stref->win();
+        _st_ref->srs() = stref->srs();
+        _st_ref->ny() = 1;
+        _st_ref->nx() = 1;
+        _st_ref->t0() = stref->t0();
+        _st_ref->t1() = stref->t1();
+        _st_ref->dt(stref->dt());
+    }
+};
+
+}  // namespace gdalcubes
+
+#endif  //REDUCE_SPACE_INCREMENTAL_H
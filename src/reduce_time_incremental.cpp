@@ -0,0 +1,93 @@
+
+#include "reduce_time_incremental.h"
+
+#include "parallel_reduce.h"
+
+#include <cstdlib>
+
+namespace gdalcubes {
+
+reduce_time_incremental_cube::reduce_time_incremental_cube(std::shared_ptr<cube> in, std::vector<std::pair<std::string, std::string>> reducer_bands, uint32_t approx_quantile_compression) : cube(std::make_shared<cube_st_reference>(*(in->st_reference()))), _in_cube(in), _reducer_bands(reducer_bands), _approx_quantile_compression(approx_quantile_compression) {
+    _st_ref->dt((_st_ref->t1() - _st_ref->t0()) + 1);
+    _st_ref->t1() = _st_ref->t0();  // set nt=1
+    _chunk_size[0] = 1;
+    _chunk_size[1] = _in_cube->chunk_size()[1];
+    _chunk_size[2] = _in_cube->chunk_size()[2];
+
+    for (uint16_t i = 0; i < reducer_bands.size(); ++i) {
+        std::string reducerstr = std::get<0>(reducer_bands[i]);
+        std::string bandstr = std::get<1>(reducer_bands[i]);
+        if (!incremental_reducer::is_supported(reducerstr)) {
+            throw std::string("ERROR in reduce_time_incremental_cube::reduce_time_incremental_cube(): Unknown reducer given");
+        }
+        if (!in->bands().has(bandstr)) {
+            throw std::string("ERROR in reduce_time_incremental_cube::reduce_time_incremental_cube(): Input data cube has no band '" + bandstr + "'");
+        }
+        band b = in->bands().get(bandstr);
+        b.name = bandstr + "_" + reducerstr;
+        if (reducerstr == "count" || reducerstr == "which_min" || reducerstr == "which_max") {
+            b.scale = 1;
+            b.offset = 0;
+            b.unit = "";
+        }
+        _bands.add(b);
+    }
+}
+
+std::shared_ptr<chunk_data> reduce_time_incremental_cube::read_chunk(chunkid_t id) {
+    GCBS_TRACE("reduce_time_incremental_cube::read_chunk(" + std::to_string(id) + ")");
+    std::shared_ptr<chunk_data> out = std::make_shared<chunk_data>();
+    if (id < 0 || id >= count_chunks())
+        return out;  // chunk is outside of the view, we don't need to read anything.
+
+    coords_nd<uint32_t, 3> size_tyx = chunk_size(id);
+    coords_nd<uint32_t, 4> size_btyx = {uint32_t(_reducer_bands.size()), 1, size_tyx[1], size_tyx[2]};
+    uint64_t ncells = uint64_t(size_tyx[1]) * uint64_t(size_tyx[2]);
+
+    std::vector<uint16_t> band_idx;
+    for (uint16_t i = 0; i < _reducer_bands.size(); ++i) {
+        band_idx.push_back(_in_cube->bands().get_index(_reducer_bands[i].second));
+    }
+
+    // input chunks with the same spatial extent have ids id, id + nxy, id + 2*nxy, ...
+    uint32_t nchunks_xy = _in_cube->count_chunks_x() * _in_cube->count_chunks_y();
+    uint32_t nchunks_t = _in_cube->count_chunks_t();
+
+    auto init_states = [this, ncells]() {
+        reducer_states states;
+        for (uint16_t i = 0; i < _reducer_bands.size(); ++i) {
+            states.push_back(incremental_reducer::create(_reducer_bands[i].first, _approx_quantile_compression));
+            states.back()->init(ncells);
+        }
+        return states;
+    };
+    auto process_chunk = [this, id, nchunks_xy, ncells, &band_idx](uint32_t ct, reducer_states &states) {
+        std::shared_ptr<chunk_data> x = _in_cube->read_chunk(id + ct * nchunks_xy);
+        if (x->empty()) return;
+        uint32_t t_offset = ct * _in_cube->chunk_size()[0];
+        for (uint16_t i = 0; i < _reducer_bands.size(); ++i) {
+            for (uint32_t t = 0; t < x->size()[1]; ++t) {
+                const double *v = ((double *)x->buf()) + (uint64_t(band_idx[i]) * x->size()[1] + t) * ncells;
+                states[i]->update(v, t_offset + t);
+            }
+        }
+    };
+    reducer_states r = parallel_reduce(nchunks_t, parallel_reduce_threads(count_chunks(), nchunks_t), init_states, process_chunk);
+
+    out->size(size_btyx);
+    out->buf(std::calloc(size_btyx[0] * size_btyx[1] * size_btyx[2] * size_btyx[3], sizeof(double)));
+    for (uint16_t i = 0; i < _reducer_bands.size(); ++i) {
+        r[i]->finalize(((double *)out->buf()) + i * ncells);
+    }
+    return out;
+}
+
+void reduce_time_incremental_cube::register_cube_type() {
+    cube_factory::instance()->register_cube_type("reduce_time_incremental", [](nlohmann::json& j) {
+        std::vector<std::pair<std::string, std::string>> reducer_bands = j["reducer_bands"].get<std::vector<std::pair<std::string, std::string>>>();
+        uint32_t compression = j.count("approx_quantile_compression") ? j["approx_quantile_compression"].get<uint32_t>() : 50;
+        return reduce_time_incremental_cube::create(cube_factory::instance()->create_from_json(j["in_cube"]), reducer_bands, compression);
+    });
+}
+
+}  // namespace gdalcubes
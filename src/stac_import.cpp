@@ -0,0 +1,329 @@
+
+#include "stac_import.h"
+
+#include "calendar.h"
+#include "image_metadata.h"
+#include "parallel_for.h"
+
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <map>
+
+namespace gdalcubes {
+
+namespace {
+
+void exec(sqlite3 *db, std::string sql) {
+    char *err = nullptr;
+    if (sqlite3_exec(db, sql.c_str(), NULL, NULL, &err) != SQLITE_OK) {
+        std::string msg = err ? err : "unknown error";
+        sqlite3_free(err);
+        throw std::string("ERROR in stac_import::create(): " + msg);
+    }
+}
+
+bool starts_with(const std::string &s, const std::string &prefix) {
+    return s.compare(0, prefix.size(), prefix) == 0;
+}
+
+// GDAL dataset descriptor of an asset href, relative paths are resolved against the directory of the item file
+std::string descriptor_of(std::string href, std::string dir) {
+    if (starts_with(href, "http://") || starts_with(href, "https://")) return "/vsicurl/" + href;
+    if (starts_with(href, "s3://")) return "/vsis3/" + href.substr(5);
+    if (starts_with(href, "gs://")) return "/vsigs/" + href.substr(5);
+    if (starts_with(href, "file://")) href = href.substr(7);
+    bool absolute = starts_with(href, "/") || starts_with(href, "\\") || (href.size() > 1 && href[1] == ':');
+    if (absolute || dir.empty()) return href;
+    if (starts_with(href, "./")) href = href.substr(2);
+    return dir + "/" + href;
+}
+
+// convert an RFC 3339 date / time (e.g. 2018-01-31T10:40:00.5-05:00) to "YYYY-MM-DDTHH:MM:SS" in UTC, date / times without
+// time zone designator are assumed to be in UTC, fractional seconds are dropped
+std::string utc_datetime(std::string dt) {
+    int y = 0, m = 0, d = 0, hh = 0, mm = 0, ss = 0, n = 0;
+    if (std::sscanf(dt.c_str(), "%4d-%2d-%2d%n", &y, &m, &d, &n) != 3) {
+        throw std::string("invalid datetime '" + dt + "'");
+    }
+    std::size_t pos = n;
+    if (pos < dt.size() && (dt[pos] == 'T' || dt[pos] == 't' || dt[pos] == ' ')) {
+        if (std::sscanf(dt.c_str() + pos + 1, "%2d:%2d:%2d%n", &hh, &mm, &ss, &n) != 3) {
+            throw std::string("invalid datetime '" + dt + "'");
+        }
+        pos += 1 + n;
+        if (pos < dt.size() && dt[pos] == '.') {
+            do {
+                ++pos;
+            } while (pos < dt.size() && std::isdigit(static_cast<unsigned char>(dt[pos])));
+        }
+    }
+    int offset = 0;  // minutes east of UTC
+    if (pos < dt.size() && (dt[pos] == 'Z' || dt[pos] == 'z')) {
+        ++pos;
+    } else if (pos < dt.size() && (dt[pos] == '+' || dt[pos] == '-')) {
+        // +HH:MM, +HHMM, or +HH
+        std::string z = dt.substr(pos + 1);
+        z.erase(std::remove(z.begin(), z.end(), ':'), z.end());
+        if ((z.size() != 2 && z.size() != 4) || !std::all_of(z.begin(), z.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)); })) {
+            throw std::string("invalid time zone of datetime '" + dt + "'");
+        }
+        offset = std::stoi(z.substr(0, 2)) * 60 + (z.size() == 4 ? std::stoi(z.substr(2, 2)) : 0);
+        if (dt[pos] == '-') offset = -offset;
+        pos = dt.size();
+    }
+    if (pos != dt.size() || m < 1 || m > 12 || d < 1 || d > 31 || hh > 23 || mm > 59 || ss > 60) {
+        throw std::string("invalid datetime '" + dt + "'");
+    }
+    // leap seconds are not representable
+    int64_t secs = calendar::days_from_civil(y, m, d) * 86400 + hh * 3600 + mm * 60 + std::min(ss, 59) - int64_t(offset) * 60;
+    int64_t days = (secs >= 0 ? secs : secs - 86399) / 86400;
+    secs -= days * 86400;
+    int64_t yy, mo, dd;
+    calendar::civil_from_days(days, yy, mo, dd);
+    char out[32];
+    std::snprintf(out, sizeof(out), "%04d-%02d-%02dT%02d:%02d:%02d", int(yy), int(mo), int(dd), int(secs / 3600), int((secs / 60) % 60), int(secs % 60));
+    return out;
+}
+
+}  // namespace
+
+std::string stac_import::attribute_name(std::string key) {
+    // e.g. eo:cloud_cover becomes eo_cloud_cover, such that attributes can be used in filter expressions without quotes
+    for (uint32_t i = 0; i < key.size(); ++i) {
+        if (!std::isalnum(static_cast<unsigned char>(key[i]))) key[i] = '_';
+    }
+    return key;
+}
+
+stac_import::item stac_import::parse_item(nlohmann::json &j, std::string dir) {
+    item out;
+    out.id = j.at("id").get<std::string>();
+    nlohmann::json &bbox = j.at("bbox");
+    if (bbox.size() == 4) {
+        out.left = bbox[0].get<double>();
+        out.bottom = bbox[1].get<double>();
+        out.right = bbox[2].get<double>();
+        out.top = bbox[3].get<double>();
+    } else if (bbox.size() == 6) {
+        out.left = bbox[0].get<double>();
+        out.bottom = bbox[1].get<double>();
+        out.right = bbox[3].get<double>();
+        out.top = bbox[4].get<double>();
+    } else {
+        throw std::string("invalid bbox");
+    }
+
+    nlohmann::json &props = j.at("properties");
+    std::string dt;
+    if (props.count("datetime") && props["datetime"].is_string()) {
+        dt = props["datetime"].get<std::string>();
+    } else if (props.count("start_datetime") && props["start_datetime"].is_string()) {
+        dt = props["start_datetime"].get<std::string>();
+    } else {
+        throw std::string("missing datetime");
+    }
+    // datetime::from_string() does not support time zones, image date / times are stored in UTC
+    out.datetime = utc_datetime(dt);
+
+    if (props.count("proj:epsg") && props["proj:epsg"].is_number()) {
+        out.proj = "EPSG:" + std::to_string(props["proj:epsg"].get<int>());
+    } else if (props.count("proj:wkt2") && props["proj:wkt2"].is_string()) {
+        out.proj = props["proj:wkt2"].get<std::string>();
+    } else {
+        out.proj = "EPSG:4326";
+    }
+
+    for (auto it = props.begin(); it != props.end(); ++it) {
+        if (it.value().is_number() || it.value().is_string() || it.value().is_boolean()) {
+            out.properties.push_back(std::make_pair(it.key(), it.value()));
+        }
+    }
+
+    nlohmann::json &assets = j.at("assets");
+    for (auto it = assets.begin(); it != assets.end(); ++it) {
+        if (it.value().count("href")) {
+            out.assets.push_back(std::make_pair(it.key(), descriptor_of(it.value()["href"].get<std::string>(), dir)));
+        }
+    }
+    return out;
+}
+
+uint32_t stac_import::parse_file(std::string file, std::vector<item> &out) {
+    std::ifstream f(file);
+    nlohmann::json j;
+    try {
+        f >> j;
+    } catch (...) {
+        throw std::string("invalid JSON");
+    }
+    std::size_t pos = file.find_last_of("/\\");
+    std::string dir = (pos == std::string::npos) ? "" : file.substr(0, pos);
+    nlohmann::json *features = &j;
+    if (j.count("type") && j["type"] == "FeatureCollection") {
+        features = &j.at("features");
+        if (!features->is_array()) {
+            throw std::string("invalid feature collection");
+        }
+    } else {
+        // a single item is treated like a feature collection with one feature
+        j = nlohmann::json::array({j});
+    }
+    uint32_t ninvalid = 0;
+    for (uint32_t i = 0; i < features->size(); ++i) {
+        try {
+            out.push_back(parse_item((*features)[i], dir));
+        } catch (std::string s) {
+            GCBS_DEBUG("Skipping STAC item " + std::to_string(i) + " of '" + file + "': " + s);
+            ++ninvalid;
+        } catch (...) {
+            GCBS_DEBUG("Skipping STAC item " + std::to_string(i) + " of '" + file + "': missing or invalid item fields");
+            ++ninvalid;
+        }
+    }
+    return ninvalid;
+}
+
+uint32_t stac_import::create(collection_format format, std::vector<std::string> files, std::string outfile) {
+    // empty collection with bands of the format
+    std::make_shared<image_collection>(format)->write(outfile);
+    std::shared_ptr<image_collection> ic = std::make_shared<image_collection>(outfile);
+    sqlite3 *db = ic->get_db_handle();
+
+    std::map<std::string, int> band_id;
+    sqlite3_stmt *stmt = nullptr;
+    if (sqlite3_prepare_v2(db, "SELECT id, name FROM bands;", -1, &stmt, NULL) != SQLITE_OK) {
+        throw std::string("ERROR in stac_import::create(): " + std::string(sqlite3_errmsg(db)));
+    }
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        band_id[reinterpret_cast<const char *>(sqlite3_column_text(stmt, 1))] = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+
+    // insert all images, references, and attributes in one transaction
+    image_metadata::create_table(db);
+    sqlite3_stmt *stmt_img = nullptr, *stmt_ref = nullptr, *stmt_md = nullptr;
+    if (sqlite3_prepare_v2(db, "INSERT OR IGNORE INTO images (name, \"left\", \"top\", \"bottom\", \"right\", datetime, proj) VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7);", -1, &stmt_img, NULL) != SQLITE_OK ||
+        sqlite3_prepare_v2(db, "INSERT INTO gdalrefs (image_id, band_id, descriptor, band_num) VALUES (?1, ?2, ?3, 1);", -1, &stmt_ref, NULL) != SQLITE_OK ||
+        sqlite3_prepare_v2(db, "INSERT OR REPLACE INTO image_md (image_id, key, value) VALUES (?1, ?2, ?3);", -1, &stmt_md, NULL) != SQLITE_OK) {
+        std::string msg = sqlite3_errmsg(db);
+        sqlite3_finalize(stmt_img);
+        sqlite3_finalize(stmt_ref);
+        sqlite3_finalize(stmt_md);
+        throw std::string("ERROR in stac_import::create(): " + msg);
+    }
+    auto step = [db](sqlite3_stmt *stmt) {
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            throw std::string("ERROR in stac_import::create(): " + std::string(sqlite3_errmsg(db)));
+        }
+    };
+
+    // files are parsed in parallel batches, parsed items of a batch are inserted before the next batch is parsed such that
+    // memory consumption does not grow with the number of files
+    const uint32_t batch_size = 1024;
+    std::atomic<uint32_t> nfailed(0), ninvalid(0);
+    uint32_t nimages = 0, nduplicates = 0, nwithout_bands = 0;
+    exec(db, "BEGIN TRANSACTION;");
+    try {
+        for (uint32_t b = 0; b < files.size(); b += batch_size) {
+            uint32_t nb = std::min(batch_size, uint32_t(files.size()) - b);
+            std::vector<std::vector<item>> items(nb);
+            parallel_for(nb, [&](uint32_t k) {
+                try {
+                    ninvalid += parse_file(files[b + k], items[k]);
+                } catch (std::string s) {
+                    GCBS_DEBUG("Skipping STAC file '" + files[b + k] + "': " + s);
+                    items[k].clear();
+                    ++nfailed;
+                } catch (...) {
+                    GCBS_DEBUG("Skipping STAC file '" + files[b + k] + "': invalid file structure");
+                    items[k].clear();
+                    ++nfailed;
+                }
+            });
+
+            for (uint32_t k = 0; k < items.size(); ++k) {
+                for (uint64_t i = 0; i < items[k].size(); ++i) {
+                    item &it = items[k][i];
+                    std::vector<std::pair<int, std::string>> refs;
+                    for (uint16_t ia = 0; ia < it.assets.size(); ++ia) {
+                        if (band_id.count(it.assets[ia].first)) {
+                            refs.push_back(std::make_pair(band_id[it.assets[ia].first], it.assets[ia].second));
+                        }
+                    }
+                    if (refs.empty()) {
+                        ++nwithout_bands;
+                        continue;
+                    }
+                    sqlite3_reset(stmt_img);
+                    sqlite3_bind_text(stmt_img, 1, it.id.c_str(), -1, SQLITE_TRANSIENT);
+                    sqlite3_bind_double(stmt_img, 2, it.left);
+                    sqlite3_bind_double(stmt_img, 3, it.top);
+                    sqlite3_bind_double(stmt_img, 4, it.bottom);
+                    sqlite3_bind_double(stmt_img, 5, it.right);
+                    sqlite3_bind_text(stmt_img, 6, it.datetime.c_str(), -1, SQLITE_TRANSIENT);
+                    sqlite3_bind_text(stmt_img, 7, it.proj.c_str(), -1, SQLITE_TRANSIENT);
+                    step(stmt_img);
+                    if (sqlite3_changes(db) == 0) {
+                        ++nduplicates;
+                        continue;
+                    }
+                    sqlite3_int64 image_id = sqlite3_last_insert_rowid(db);
+                    for (uint16_t ir = 0; ir < refs.size(); ++ir) {
+                        sqlite3_reset(stmt_ref);
+                        sqlite3_bind_int64(stmt_ref, 1, image_id);
+                        sqlite3_bind_int(stmt_ref, 2, refs[ir].first);
+                        sqlite3_bind_text(stmt_ref, 3, refs[ir].second.c_str(), -1, SQLITE_TRANSIENT);
+                        step(stmt_ref);
+                    }
+                    for (uint16_t ip = 0; ip < it.properties.size(); ++ip) {
+                        std::string key = attribute_name(it.properties[ip].first);
+                        if (image_metadata::is_reserved(key)) continue;
+                        nlohmann::json &v = it.properties[ip].second;
+                        sqlite3_reset(stmt_md);
+                        sqlite3_bind_int64(stmt_md, 1, image_id);
+                        sqlite3_bind_text(stmt_md, 2, key.c_str(), -1, SQLITE_TRANSIENT);
+                        if (v.is_string()) {
+                            sqlite3_bind_text(stmt_md, 3, v.get<std::string>().c_str(), -1, SQLITE_TRANSIENT);
+                        } else {
+                            sqlite3_bind_double(stmt_md, 3, v.is_boolean() ? double(v.get<bool>()) : v.get<double>());
+                        }
+                        step(stmt_md);
+                    }
+                    ++nimages;
+                }
+                std::vector<item>().swap(items[k]);
+            }
+        }
+    } catch (std::string s) {
+        sqlite3_finalize(stmt_img);
+        sqlite3_finalize(stmt_ref);
+        sqlite3_finalize(stmt_md);
+        exec(db, "ROLLBACK;");
+        throw s;
+    }
+    sqlite3_finalize(stmt_img);
+    sqlite3_finalize(stmt_ref);
+    sqlite3_finalize(stmt_md);
+    exec(db, "COMMIT;");
+
+    if (nfailed > 0) {
+        GCBS_WARN(std::to_string(nfailed) + " STAC file(s) could not be read and have been skipped");
+    }
+    if (ninvalid > 0) {
+        GCBS_WARN(std::to_string(ninvalid) + " invalid STAC item(s) (e.g. without valid datetime) have been skipped");
+    }
+    if (nduplicates > 0) {
+        GCBS_WARN(std::to_string(nduplicates) + " STAC item(s) with duplicate ids have been ignored");
+    }
+    if (nwithout_bands > 0) {
+        GCBS_WARN(std::to_string(nwithout_bands) + " STAC item(s) without assets matching the bands of the collection format have been ignored");
+    }
+    return nimages;
+}
+
+}  // namespace gdalcubes
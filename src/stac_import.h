@@ -0,0 +1,57 @@
+
+#ifndef STAC_IMPORT_H
+#define STAC_IMPORT_H
+
+#include "gdalcubes/src/gdalcubes.h"
+
+namespace gdalcubes {
+
+/**
+ * @brief Create image collections from local STAC item JSON files without opening any image
+ *
+ * Spatial extent, acquisition date / time, spatial reference system, and file references of images are taken from STAC items
+ * (https://stacspec.org) instead of reading image files with GDAL. Files are parsed in parallel batches and invalid items are
+ * skipped. Items of a batch are inserted before the next batch is parsed. All images, file references, and attributes are
+ * inserted into the collection's database in a single transaction. Date / times with time zone offsets are converted to UTC.
+ * Assets are matched to bands of the collection format by their keys. Numeric and string item properties are stored as image
+ * attributes (see image_metadata).
+ */
+class stac_import {
+   public:
+    /**
+     * @brief Create an image collection from STAC items
+     *
+     * @param format collection format defining the bands of the collection, band names must match asset keys of the items
+     * @param files paths of JSON files, each containing a single STAC item or a feature collection of items
+     * @param outfile path of the created image collection file
+     * @return number of imported images
+     */
+    static uint32_t create(collection_format format, std::vector<std::string> files, std::string outfile);
+
+   protected:
+    struct item {
+        std::string id;
+        double left;
+        double right;
+        double bottom;
+        double top;
+        std::string datetime;
+        std::string proj;
+        std::vector<std::pair<std::string, std::string>> assets;  // (band name, GDAL dataset descriptor)
+        std::vector<std::pair<std::string, nlohmann::json>> properties;
+    };
+
+    /**
+     * @brief Parse a file with a single item or a feature collection of items
+     * @param file path of the JSON file
+     * @param out valid items of the file are appended
+     * @return number of invalid items that have been skipped
+     */
+    static uint32_t parse_file(std::string file, std::vector<item> &out);
+    static item parse_item(nlohmann::json &j, std::string dir);
+    static std::string attribute_name(std::string key);
+};
+
+}  // namespace gdalcubes
+
+#endif  //STAC_IMPORT_H
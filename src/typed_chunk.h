@@ -0,0 +1,156 @@
+
+#ifndef TYPED_CHUNK_H
+#define TYPED_CHUNK_H
+
+#include "gdalcubes/src/gdalcubes.h"
+#include "kernels.h"
+
+#include <array>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace gdalcubes {
+
+/**
+ * @brief Element types of chunk buffers on the package side
+ */
+enum class element_type {
+    FLOAT64,
+    FLOAT32,
+    UINT8,
+    UINT16,
+    UINT32,
+    INT16,
+    INT32
+};
+
+/**
+ * @brief Convert a string to an element type
+ * @param s "float64" / "double", "float32" / "float", "uint8", "uint16", "uint32", "int16", or "int32"
+ * @return element type
+ */
+inline element_type element_type_from_string(std::string s) {
+    if (s == "float32" || s == "float") {
+        return element_type::FLOAT32;
+    }
+    if (s == "float64" || s == "double") {
+        return element_type::FLOAT64;
+    }
+    if (s == "uint8") return element_type::UINT8;
+    if (s == "uint16") return element_type::UINT16;
+    if (s == "uint32") return element_type::UINT32;
+    if (s == "int16") return element_type::INT16;
+    if (s == "int32") return element_type::INT32;
+    throw std::string("ERROR in element_type_from_string(): invalid element type '" + s + "'");
+}
+
+/**
+ * @brief Check whether values of an element type must be packed with offset, scale, and nodata
+ */
+inline bool is_packed_type(element_type t) {
+    return t != element_type::FLOAT64 && t != element_type::FLOAT32;
+}
+
+/**
+ * @brief Parameters to pack double values to integer element types
+ *
+ * Packed values are computed as round((v - offset) / scale), NaN values are stored as nodata.
+ * Vectors have either length one (same parameters for all bands) or one element per band. If offset and scale are empty,
+ * parameters are derived automatically from the range of values (see typed_export::auto_packing()).
+ */
+struct packing {
+    std::vector<double> offset;
+    std::vector<double> scale;
+    std::vector<double> nodata;
+
+    /**
+     * @brief Directory where chunks are temporarily stored while deriving automatic packing parameters
+     */
+    std::string tmpdir;
+
+    inline bool is_auto() const { return offset.empty() || scale.empty(); }
+
+    inline double offset_of(uint16_t b) const { return offset.size() == 1 ? offset[0] : offset[b]; }
+    inline double scale_of(uint16_t b) const { return scale.size() == 1 ? scale[0] : scale[b]; }
+    inline double nodata_of(uint16_t b) const { return nodata.size() == 1 ? nodata[0] : nodata[b]; }
+};
+
+/**
+ * @brief Chunk data with configurable element type
+ *
+ * chunk_data objects produced by cubes always store double values. This class holds a copy of
+ * a chunk with another element type, e.g. float to halve the memory footprint and
+ * bandwidth when chunks are passed to writers. The memory layout is identical to chunk_data, i.e.
+ * values are stored in the order band, time, y, x.
+ *
+ * @tparam T element type, typically float or double
+ */
+template <typename T>
+class typed_chunk_data {
+   public:
+    typed_chunk_data() : _buf(), _size({{0, 0, 0, 0}}) {}
+
+    /**
+     * @brief Create a typed copy of a chunk
+     * @param c input chunk
+     * @return typed chunk, empty if c is empty
+     */
+    static std::shared_ptr<typed_chunk_data<T>> from(std::shared_ptr<chunk_data> c) {
+        std::shared_ptr<typed_chunk_data<T>> out = std::make_shared<typed_chunk_data<T>>();
+        if (!c || c->empty()) {
+            return out;
+        }
+        out->_size = {{c->size()[0], c->size()[1], c->size()[2], c->size()[3]}};
+        out->_buf.resize(out->count_elements());
+        kernels::convert<T>((double *)c->buf(), out->_buf.data(), out->count_elements());
+        return out;
+    }
+
+    /**
+     * @brief Create a packed copy of a chunk
+     *
+     * Packed values are clamped to the range of T, excluding the nodata value if it is the lowest or highest
+     * representable value.
+     *
+     * @param c input chunk
+     * @param p packing parameters, must not be automatic
+     * @return typed chunk, empty if c is empty
+     */
+    static std::shared_ptr<typed_chunk_data<T>> pack(std::shared_ptr<chunk_data> c, const packing &p) {
+        std::shared_ptr<typed_chunk_data<T>> out = std::make_shared<typed_chunk_data<T>>();
+        if (!c || c->empty()) {
+            return out;
+        }
+        out->_size = {{c->size()[0], c->size()[1], c->size()[2], c->size()[3]}};
+        out->_buf.resize(out->count_elements());
+        uint64_t nband = out->count_elements() / out->_size[0];
+        for (uint16_t b = 0; b < out->_size[0]; ++b) {
+            double lo = double(std::numeric_limits<T>::lowest());
+            double hi = double(std::numeric_limits<T>::max());
+            if (p.nodata_of(b) == lo) lo += 1;
+            if (p.nodata_of(b) == hi) hi -= 1;
+            kernels::pack<T>((double *)c->buf() + b * nband, out->_buf.data() + b * nband, nband,
+                             p.offset_of(b), p.scale_of(b), static_cast<T>(p.nodata_of(b)), lo, hi);
+        }
+        return out;
+    }
+
+    inline T *buf() { return _buf.data(); }
+    inline std::array<uint32_t, 4> size() { return _size; }
+    inline bool empty() { return _buf.empty(); }
+
+    inline uint64_t count_elements() {
+        return uint64_t(_size[0]) * uint64_t(_size[1]) * uint64_t(_size[2]) * uint64_t(_size[3]);
+    }
+    inline uint64_t total_size_bytes() { return count_elements() * sizeof(T); }
+
+   private:
+    std::vector<T> _buf;
+    std::array<uint32_t, 4> _size;
+};
+
+}  // namespace gdalcubes
+
+#endif  //TYPED_CHUNK_H
@@ -0,0 +1,898 @@
+
+#include "typed_export.h"
+
+#include "cube_store.h"
+
+#include <gdal_priv.h>
+#include <gdal_utils.h>
+#include <netcdf.h>
+#include <zlib.h>
+#ifdef GDALCUBES_HDF5_DIRECT_CHUNK
+#include <hdf5.h>
+#endif
+
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <limits>
+#include <thread>
+
+namespace gdalcubes {
+
+namespace {
+
+// removes the temporary cube store of automatic packing when leaving the scope, also if auto_packing() fails
+struct packing_store_guard {
+    packing_store_guard() : dir(), count_chunks(0) {}
+    ~packing_store_guard() {
+        if (dir.empty()) return;
+        try {
+            cube_store_cube::remove(dir, count_chunks);
+        } catch (...) {
+        }
+    }
+    std::string dir;
+    chunkid_t count_chunks;
+};
+
+inline void nc_check(int retval, std::string where) {
+    if (retval != NC_NOERR) {
+        throw std::string("ERROR in " + where + "(): " + nc_strerror(retval));
+    }
+}
+
+inline int nc_put_vara_typed(int ncid, int varid, const size_t *start, const size_t *count, const float *v) {
+    return nc_put_vara_float(ncid, varid, start, count, v);
+}
+inline int nc_put_vara_typed(int ncid, int varid, const size_t *start, const size_t *count, const double *v) {
+    return nc_put_vara_double(ncid, varid, start, count, v);
+}
+inline int nc_put_vara_typed(int ncid, int varid, const size_t *start, const size_t *count, const uint8_t *v) {
+    return nc_put_vara_uchar(ncid, varid, start, count, v);
+}
+inline int nc_put_vara_typed(int ncid, int varid, const size_t *start, const size_t *count, const uint16_t *v) {
+    return nc_put_vara_ushort(ncid, varid, start, count, v);
+}
+inline int nc_put_vara_typed(int ncid, int varid, const size_t *start, const size_t *count, const uint32_t *v) {
+    return nc_put_vara_uint(ncid, varid, start, count, v);
+}
+inline int nc_put_vara_typed(int ncid, int varid, const size_t *start, const size_t *count, const int16_t *v) {
+    return nc_put_vara_short(ncid, varid, start, count, v);
+}
+inline int nc_put_vara_typed(int ncid, int varid, const size_t *start, const size_t *count, const int32_t *v) {
+    return nc_put_vara_int(ncid, varid, start, count, v);
+}
+
+template <typename T>
+inline nc_type nc_type_of();
+template <>
+inline nc_type nc_type_of<float>() { return NC_FLOAT; }
+template <>
+inline nc_type nc_type_of<double>() { return NC_DOUBLE; }
+template <>
+inline nc_type nc_type_of<uint8_t>() { return NC_UBYTE; }
+template <>
+inline nc_type nc_type_of<uint16_t>() { return NC_USHORT; }
+template <>
+inline nc_type nc_type_of<uint32_t>() { return NC_UINT; }
+template <>
+inline nc_type nc_type_of<int16_t>() { return NC_SHORT; }
+template <>
+inline nc_type nc_type_of<int32_t>() { return NC_INT; }
+
+template <typename T>
+inline GDALDataType gdal_type_of();
+template <>
+inline GDALDataType gdal_type_of<float>() { return GDT_Float32; }
+template <>
+inline GDALDataType gdal_type_of<double>() { return GDT_Float64; }
+template <>
+inline GDALDataType gdal_type_of<uint8_t>() { return GDT_Byte; }
+template <>
+inline GDALDataType gdal_type_of<uint16_t>() { return GDT_UInt16; }
+template <>
+inline GDALDataType gdal_type_of<uint32_t>() { return GDT_UInt32; }
+template <>
+inline GDALDataType gdal_type_of<int16_t>() { return GDT_Int16; }
+template <>
+inline GDALDataType gdal_type_of<int32_t>() { return GDT_Int32; }
+
+/**
+ * Convert a chunk to the output element type in the calling worker thread, packed if packing parameters are given
+ */
+template <typename T>
+inline std::shared_ptr<typed_chunk_data<T>> typed_chunk(std::shared_ptr<chunk_data> dat, const packing *pk) {
+    return pk ? typed_chunk_data<T>::pack(dat, *pk) : typed_chunk_data<T>::from(dat);
+}
+
+/**
+ * Scale and offset of stored values, combining band metadata with packing parameters
+ */
+inline void stored_scale_offset(band b, uint16_t i, const packing *pk, double &scale, double &offset) {
+    scale = b.scale;
+    offset = b.offset;
+    if (pk) {
+        offset = b.offset + b.scale * pk->offset_of(i);
+        scale = b.scale * pk->scale_of(i);
+    }
+}
+
+template <typename T>
+inline std::string zarr_dtype_of();
+template <>
+inline std::string zarr_dtype_of<float>() { return "<f4"; }
+template <>
+inline std::string zarr_dtype_of<double>() { return "<f8"; }
+
+void write_file(std::string path, const void *data, uint64_t size) {
+    std::ofstream f(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!f.is_open()) {
+        throw std::string("ERROR in typed_export::write_zarr(): cannot write file '" + path + "'");
+    }
+    f.write((const char *)data, size);
+    f.close();
+    if (!f) {
+        throw std::string("ERROR in typed_export::write_zarr(): failed to write file '" + path + "'");
+    }
+}
+
+void write_json(std::string path, nlohmann::json &j) {
+    std::string s = j.dump(2);
+    write_file(path, s.data(), s.size());
+}
+
+std::string cf_time_unit(datetime_unit u) {
+    switch (u) {
+        case datetime_unit::YEAR:
+            return "years";
+        case datetime_unit::MONTH:
+            return "months";
+        case datetime_unit::WEEK:
+            return "weeks";
+        case datetime_unit::HOUR:
+            return "hours";
+        case datetime_unit::MINUTE:
+            return "minutes";
+        case datetime_unit::SECOND:
+            return "seconds";
+        default:
+            return "days";
+    }
+}
+
+#ifdef GDALCUBES_HDF5_DIRECT_CHUNK
+/**
+ * Write band variables of a netCDF-4 file, whose metadata has already been written and closed, by direct chunk writes
+ * to the underlying HDF5 datasets. Worker threads convert, shuffle, and deflate complete chunks exactly as the netCDF
+ * shuffle and deflate filters would, only the final H5Dwrite_chunk() calls are serialized.
+ */
+template <typename T>
+void write_netcdf_direct_chunks(std::shared_ptr<cube> c, std::string path, const size_t *chunksizes, uint8_t compression_level,
+                                const packing *pk, std::vector<T> fill, std::shared_ptr<chunk_processor> p, std::shared_ptr<progress> prg) {
+    hid_t f = H5Fopen(path.c_str(), H5F_ACC_RDWR, H5P_DEFAULT);
+    if (f < 0) {
+        throw std::string("ERROR in typed_export::write_netcdf(): cannot open '" + path + "' for direct chunk writes");
+    }
+    std::vector<hid_t> datasets(c->bands().count());
+    for (uint16_t i = 0; i < c->bands().count(); ++i) {
+        datasets[i] = H5Dopen2(f, c->bands().get(i).name.c_str(), H5P_DEFAULT);
+    }
+
+    uint64_t nchunk = uint64_t(chunksizes[0]) * uint64_t(chunksizes[1]) * uint64_t(chunksizes[2]);
+    std::function<void(chunkid_t, std::shared_ptr<chunk_data>, std::mutex &)> fn = [c, &datasets, chunksizes, nchunk, compression_level, pk, &fill, prg](chunkid_t id, std::shared_ptr<chunk_data> dat, std::mutex &m) {
+        if (!dat->empty()) {
+            std::shared_ptr<typed_chunk_data<T>> tdat = typed_chunk<T>(dat, pk);
+            dat.reset();
+            bounds_nd<uint32_t, 3> lim = c->chunk_limits(id);
+            uint32_t csize_t = tdat->size()[1], csize_y = tdat->size()[2], csize_x = tdat->size()[3];
+            uint64_t nband = uint64_t(csize_t) * uint64_t(csize_y) * uint64_t(csize_x);
+
+            // HDF5 chunks always have the full chunk size, chunks at the boundary are padded with fill values
+            std::vector<T> full(nchunk);
+            std::vector<unsigned char> shuffled(nchunk * sizeof(T));
+            std::vector<std::vector<unsigned char>> compressed(tdat->size()[0]);
+            for (uint16_t i = 0; i < tdat->size()[0]; ++i) {
+                std::fill(full.begin(), full.end(), fill[i]);
+                for (uint32_t it = 0; it < csize_t; ++it) {
+                    for (uint32_t iy = 0; iy < csize_y; ++iy) {
+                        const T *src = tdat->buf() + i * nband + (uint64_t(it) * csize_y + iy) * csize_x;
+                        std::copy(src, src + csize_x, full.data() + (uint64_t(it) * chunksizes[1] + iy) * chunksizes[2]);
+                    }
+                }
+                const unsigned char *bytes = (const unsigned char *)full.data();
+                for (uint64_t k = 0; k < nchunk; ++k) {
+                    for (uint32_t b = 0; b < sizeof(T); ++b) {
+                        shuffled[b * nchunk + k] = bytes[k * sizeof(T) + b];
+                    }
+                }
+                uLongf len = compressBound(shuffled.size());
+                compressed[i].resize(len);
+                if (compress2(compressed[i].data(), &len, shuffled.data(), shuffled.size(), compression_level) != Z_OK) {
+                    // the chunk processor reports the chunk as failed, no band of the chunk is written
+                    throw std::string("ERROR in typed_export::write_netcdf(): failed to compress chunk " + std::to_string(id));
+                }
+                compressed[i].resize(len);
+            }
+            tdat.reset();
+
+            hsize_t offset[] = {lim.low[0], lim.low[1], lim.low[2]};
+            std::lock_guard<std::mutex> lock(m);
+            for (uint16_t i = 0; i < compressed.size(); ++i) {
+                if (H5Dwrite_chunk(datasets[i], H5P_DEFAULT, 0, offset, compressed[i].size(), compressed[i].data()) < 0) {
+                    throw std::string("ERROR in typed_export::write_netcdf(): failed to write chunk " + std::to_string(id) + " to netCDF file");
+                }
+            }
+        }
+        prg->increment((double)1 / (double)c->count_chunks());
+    };
+    p->apply(c, fn);
+
+    for (uint16_t i = 0; i < datasets.size(); ++i) {
+        H5Dclose(datasets[i]);
+    }
+    H5Fclose(f);
+}
+#endif
+
+}  // namespace
+
+void typed_export::write_netcdf(std::shared_ptr<cube> c, std::string path, element_type type,
+                                uint8_t compression_level, bool write_bounds,
+                                std::shared_ptr<chunk_processor> p) {
+    if (!p) {
+        p = config::instance()->get_default_chunk_processor();
+    }
+    if (is_packed_type(type)) {
+        throw std::string("ERROR in typed_export::write_netcdf(): integer element types require packing parameters");
+    }
+    if (type == element_type::FLOAT32) {
+        write_netcdf_impl<float>(c, path, compression_level, write_bounds, nullptr, p);
+    } else {
+        write_netcdf_impl<double>(c, path, compression_level, write_bounds, nullptr, p);
+    }
+}
+
+void typed_export::write_netcdf_packed(std::shared_ptr<cube> c, std::string path, element_type type, packing pk,
+                                       uint8_t compression_level, bool write_bounds,
+                                       std::shared_ptr<chunk_processor> p) {
+    if (!p) {
+        p = config::instance()->get_default_chunk_processor();
+    }
+    packing_store_guard store;
+    if (pk.is_auto()) {
+        store.dir = pk.tmpdir;
+        store.count_chunks = c->count_chunks();
+        pk = auto_packing(c, type, pk, p);
+    }
+    switch (type) {
+        case element_type::UINT8:
+            write_netcdf_impl<uint8_t>(c, path, compression_level, write_bounds, &pk, p);
+            break;
+        case element_type::UINT16:
+            write_netcdf_impl<uint16_t>(c, path, compression_level, write_bounds, &pk, p);
+            break;
+        case element_type::UINT32:
+            write_netcdf_impl<uint32_t>(c, path, compression_level, write_bounds, &pk, p);
+            break;
+        case element_type::INT16:
+            write_netcdf_impl<int16_t>(c, path, compression_level, write_bounds, &pk, p);
+            break;
+        case element_type::INT32:
+            write_netcdf_impl<int32_t>(c, path, compression_level, write_bounds, &pk, p);
+            break;
+        default:
+            throw std::string("ERROR in typed_export::write_netcdf_packed(): packing requires an integer element type");
+    }
+}
+
+void typed_export::write_tif(std::shared_ptr<cube> c, std::string dir, std::string prefix, element_type type,
+                             bool overviews, bool cog, std::map<std::string, std::string> creation_options,
+                             std::string rsmpl_overview, std::shared_ptr<chunk_processor> p) {
+    if (!p) {
+        p = config::instance()->get_default_chunk_processor();
+    }
+    if (is_packed_type(type)) {
+        throw std::string("ERROR in typed_export::write_tif(): integer element types require packing parameters");
+    }
+    if (type == element_type::FLOAT32) {
+        write_tif_impl<float>(c, dir, prefix, overviews, cog, creation_options, rsmpl_overview, nullptr, p);
+    } else {
+        write_tif_impl<double>(c, dir, prefix, overviews, cog, creation_options, rsmpl_overview, nullptr, p);
+    }
+}
+
+void typed_export::write_tif_packed(std::shared_ptr<cube> c, std::string dir, std::string prefix, element_type type,
+                                    packing pk, bool overviews, bool cog,
+                                    std::map<std::string, std::string> creation_options, std::string rsmpl_overview,
+                                    std::shared_ptr<chunk_processor> p) {
+    if (!p) {
+        p = config::instance()->get_default_chunk_processor();
+    }
+    packing_store_guard store;
+    if (pk.is_auto()) {
+        store.dir = pk.tmpdir;
+        store.count_chunks = c->count_chunks();
+        pk = auto_packing(c, type, pk, p);
+    }
+    switch (type) {
+        case element_type::UINT8:
+            write_tif_impl<uint8_t>(c, dir, prefix, overviews, cog, creation_options, rsmpl_overview, &pk, p);
+            break;
+        case element_type::UINT16:
+            write_tif_impl<uint16_t>(c, dir, prefix, overviews, cog, creation_options, rsmpl_overview, &pk, p);
+            break;
+        case element_type::UINT32:
+            write_tif_impl<uint32_t>(c, dir, prefix, overviews, cog, creation_options, rsmpl_overview, &pk, p);
+            break;
+        case element_type::INT16:
+            write_tif_impl<int16_t>(c, dir, prefix, overviews, cog, creation_options, rsmpl_overview, &pk, p);
+            break;
+        case element_type::INT32:
+            write_tif_impl<int32_t>(c, dir, prefix, overviews, cog, creation_options, rsmpl_overview, &pk, p);
+            break;
+        default:
+            throw std::string("ERROR in typed_export::write_tif_packed(): packing requires an integer element type");
+    }
+}
+
+packing typed_export::auto_packing(std::shared_ptr<cube> &c, element_type type, packing pk, std::shared_ptr<chunk_processor> p) {
+    if (pk.tmpdir.empty()) {
+        throw std::string("ERROR in typed_export::auto_packing(): missing directory for temporary chunk files");
+    }
+    // same parameters as pack_minmax() in R: nodata is the lowest value for signed and zero for unsigned types
+    double low, high, nodata;
+    switch (type) {
+        case element_type::UINT8:
+            nodata = 0, low = 1, high = 255;
+            break;
+        case element_type::UINT16:
+            nodata = 0, low = 1, high = 65535;
+            break;
+        case element_type::UINT32:
+            nodata = 0, low = 1, high = 4294967295.0;
+            break;
+        case element_type::INT16:
+            nodata = -32768, low = -32767, high = 32767;
+            break;
+        case element_type::INT32:
+            nodata = -2147483648.0, low = -2147483647.0, high = 2147483647.0;
+            break;
+        default:
+            throw std::string("ERROR in typed_export::auto_packing(): packing requires an integer element type");
+    }
+
+    // chunks are stored as they are computed, the packed output is then written from the store
+    std::vector<std::pair<double, double>> range;
+    cube_store_cube::write(c, pk.tmpdir, p, &range);
+    c = cube_store_cube::create(pk.tmpdir);
+
+    packing out;
+    out.tmpdir = pk.tmpdir;
+    for (uint16_t i = 0; i < range.size(); ++i) {
+        double vmin = range[i].first, vmax = range[i].second;
+        if (!(vmin <= vmax)) {
+            vmin = vmax = 0;  // band contains only NaN values
+        }
+        double scale = (vmax > vmin) ? (vmax - vmin) / (high - low) : 1.0;
+        out.scale.push_back(scale);
+        out.offset.push_back(vmin - low * scale);
+        out.nodata.push_back(pk.nodata.empty() ? nodata : pk.nodata_of(i));
+    }
+    return out;
+}
+
+void typed_export::write_zarr(std::shared_ptr<cube> c, std::string path, element_type type,
+                              uint8_t compression_level, std::shared_ptr<chunk_processor> p) {
+    if (!p) {
+        p = config::instance()->get_default_chunk_processor();
+    }
+    if (is_packed_type(type)) {
+        throw std::string("ERROR in typed_export::write_zarr(): Zarr export supports only float32 and float64 element types");
+    }
+    if (type == element_type::FLOAT32) {
+        write_zarr_impl<float>(c, path, compression_level, p);
+    } else {
+        write_zarr_impl<double>(c, path, compression_level, p);
+    }
+}
+
+template <typename T>
+void typed_export::write_netcdf_impl(std::shared_ptr<cube> c, std::string path, uint8_t compression_level,
+                                     bool write_bounds, const packing *pk, std::shared_ptr<chunk_processor> p) {
+    std::shared_ptr<progress> prg = config::instance()->get_default_progress_bar()->get();
+    prg->set(0);
+
+    auto st = c->st_reference();
+    uint32_t nt = st->nt(), ny = st->ny(), nx = st->nx();
+
+    std::vector<double> dim_t(nt), dim_y(ny), dim_x(nx);
+    for (uint32_t i = 0; i < nt; ++i) {
+        dim_t[i] = double(i) * st->dt().dt_interval;
+    }
+    for (uint32_t i = 0; i < ny; ++i) {
+        dim_y[i] = st->top() - (i + 0.5) * st->dy();
+    }
+    for (uint32_t i = 0; i < nx; ++i) {
+        dim_x[i] = st->left() + (i + 0.5) * st->dx();
+    }
+
+    int ncout;
+    nc_check(nc_create(path.c_str(), NC_NETCDF4, &ncout), "typed_export::write_netcdf");
+
+    int d_t, d_y, d_x, d_nv = -1;
+    nc_check(nc_def_dim(ncout, "time", nt, &d_t), "typed_export::write_netcdf");
+    nc_check(nc_def_dim(ncout, "y", ny, &d_y), "typed_export::write_netcdf");
+    nc_check(nc_def_dim(ncout, "x", nx, &d_x), "typed_export::write_netcdf");
+    if (write_bounds) {
+        nc_check(nc_def_dim(ncout, "nv", 2, &d_nv), "typed_export::write_netcdf");
+    }
+
+    int v_t, v_y, v_x;
+    nc_check(nc_def_var(ncout, "time", NC_DOUBLE, 1, &d_t, &v_t), "typed_export::write_netcdf");
+    nc_check(nc_def_var(ncout, "y", NC_DOUBLE, 1, &d_y, &v_y), "typed_export::write_netcdf");
+    nc_check(nc_def_var(ncout, "x", NC_DOUBLE, 1, &d_x, &v_x), "typed_export::write_netcdf");
+
+    std::string att_t_units = cf_time_unit(st->dt().dt_unit) + " since " + st->t0().to_string(datetime_unit::SECOND);
+    nc_put_att_text(ncout, v_t, "units", att_t_units.length(), att_t_units.c_str());
+    nc_put_att_text(ncout, v_t, "calendar", 9, "gregorian");
+    nc_put_att_text(ncout, v_t, "long_name", 4, "time");
+    nc_put_att_text(ncout, v_t, "standard_name", 4, "time");
+    nc_put_att_text(ncout, v_y, "long_name", 1, "y");
+    nc_put_att_text(ncout, v_y, "standard_name", 23, "projection_y_coordinate");
+    nc_put_att_text(ncout, v_x, "long_name", 1, "x");
+    nc_put_att_text(ncout, v_x, "standard_name", 23, "projection_x_coordinate");
+
+    int v_tb = -1, v_yb = -1, v_xb = -1;
+    if (write_bounds) {
+        int d_tb[] = {d_t, d_nv};
+        int d_yb[] = {d_y, d_nv};
+        int d_xb[] = {d_x, d_nv};
+        nc_check(nc_def_var(ncout, "time_bnds", NC_DOUBLE, 2, d_tb, &v_tb), "typed_export::write_netcdf");
+        nc_check(nc_def_var(ncout, "y_bnds", NC_DOUBLE, 2, d_yb, &v_yb), "typed_export::write_netcdf");
+        nc_check(nc_def_var(ncout, "x_bnds", NC_DOUBLE, 2, d_xb, &v_xb), "typed_export::write_netcdf");
+        nc_put_att_text(ncout, v_t, "bounds", 9, "time_bnds");
+        nc_put_att_text(ncout, v_y, "bounds", 6, "y_bnds");
+        nc_put_att_text(ncout, v_x, "bounds", 6, "x_bnds");
+    }
+
+    char *wkt = NULL;
+    std::string swkt = "";
+    if (st->srs_ogr().exportToWkt(&wkt) == OGRERR_NONE) {
+        swkt = wkt;
+        CPLFree(wkt);
+    }
+    int v_crs;
+    nc_check(nc_def_var(ncout, "crs", NC_INT, 0, NULL, &v_crs), "typed_export::write_netcdf");
+    nc_put_att_text(ncout, v_crs, "spatial_ref", swkt.length(), swkt.c_str());
+    nc_put_att_text(ncout, v_crs, "crs_wkt", swkt.length(), swkt.c_str());
+    std::string geotransform = std::to_string(st->left()) + " " + std::to_string(st->dx()) + " 0 " +
+                               std::to_string(st->top()) + " 0 " + std::to_string(-st->dy());
+    nc_put_att_text(ncout, v_crs, "GeoTransform", geotransform.length(), geotransform.c_str());
+
+    // align netCDF chunks with data cube chunks
+    size_t chunksizes[] = {std::min(c->chunk_size()[0], nt), std::min(c->chunk_size()[1], ny), std::min(c->chunk_size()[2], nx)};
+    int d_all[] = {d_t, d_y, d_x};
+    std::vector<T> fill(c->bands().count());
+    std::vector<int> v_bands(c->bands().count());
+    for (uint16_t i = 0; i < c->bands().count(); ++i) {
+        band b = c->bands().get(i);
+        fill[i] = pk ? static_cast<T>(pk->nodata_of(i)) : std::numeric_limits<T>::quiet_NaN();
+        nc_check(nc_def_var(ncout, b.name.c_str(), nc_type_of<T>(), 3, d_all, &v_bands[i]), "typed_export::write_netcdf");
+        nc_check(nc_def_var_chunking(ncout, v_bands[i], NC_CHUNKED, chunksizes), "typed_export::write_netcdf");
+        if (compression_level > 0) {
+            nc_check(nc_def_var_deflate(ncout, v_bands[i], 1, 1, compression_level), "typed_export::write_netcdf");
+        }
+        nc_put_att(ncout, v_bands[i], "_FillValue", nc_type_of<T>(), 1, &fill[i]);
+        if (!b.unit.empty()) {
+            nc_put_att_text(ncout, v_bands[i], "units", b.unit.length(), b.unit.c_str());
+        }
+        double scale, offset;
+        stored_scale_offset(b, i, pk, scale, offset);
+        if (scale != 1 || offset != 0) {
+            nc_put_att_double(ncout, v_bands[i], "scale_factor", NC_DOUBLE, 1, &scale);
+            nc_put_att_double(ncout, v_bands[i], "add_offset", NC_DOUBLE, 1, &offset);
+        }
+        nc_put_att_text(ncout, v_bands[i], "grid_mapping", 3, "crs");
+    }
+    nc_check(nc_enddef(ncout), "typed_export::write_netcdf");
+
+    nc_put_var_double(ncout, v_t, dim_t.data());
+    nc_put_var_double(ncout, v_y, dim_y.data());
+    nc_put_var_double(ncout, v_x, dim_x.data());
+    if (write_bounds) {
+        std::vector<double> bnds(2 * std::max(nt, std::max(ny, nx)));
+        for (uint32_t i = 0; i < nt; ++i) {
+            bnds[2 * i] = dim_t[i];
+            bnds[2 * i + 1] = dim_t[i] + st->dt().dt_interval;
+        }
+        nc_put_var_double(ncout, v_tb, bnds.data());
+        for (uint32_t i = 0; i < ny; ++i) {
+            bnds[2 * i] = dim_y[i] + 0.5 * st->dy();
+            bnds[2 * i + 1] = dim_y[i] - 0.5 * st->dy();
+        }
+        nc_put_var_double(ncout, v_yb, bnds.data());
+        for (uint32_t i = 0; i < nx; ++i) {
+            bnds[2 * i] = dim_x[i] - 0.5 * st->dx();
+            bnds[2 * i + 1] = dim_x[i] + 0.5 * st->dx();
+        }
+        nc_put_var_double(ncout, v_xb, bnds.data());
+    }
+
+#ifdef GDALCUBES_HDF5_DIRECT_CHUNK
+    if (compression_level > 0) {
+        nc_close(ncout);
+        write_netcdf_direct_chunks<T>(c, path, chunksizes, compression_level, pk, fill, p, prg);
+        prg->finalize();
+        return;
+    }
+#endif
+
+    std::function<void(chunkid_t, std::shared_ptr<chunk_data>, std::mutex &)> f = [c, ncout, &v_bands, pk, prg](chunkid_t id, std::shared_ptr<chunk_data> dat, std::mutex &m) {
+        if (!dat->empty()) {
+            // conversion and packing happen in the worker thread, outside of the lock
+            std::shared_ptr<typed_chunk_data<T>> tdat = typed_chunk<T>(dat, pk);
+            dat.reset();
+            bounds_nd<uint32_t, 3> lim = c->chunk_limits(id);
+            size_t start[] = {lim.low[0], lim.low[1], lim.low[2]};
+            size_t count[] = {tdat->size()[1], tdat->size()[2], tdat->size()[3]};
+            uint64_t nband = uint64_t(tdat->size()[1]) * uint64_t(tdat->size()[2]) * uint64_t(tdat->size()[3]);
+            m.lock();
+            for (uint16_t i = 0; i < tdat->size()[0]; ++i) {
+                int retval = nc_put_vara_typed(ncout, v_bands[i], start, count, tdat->buf() + i * nband);
+                if (retval != NC_NOERR) {
+                    GCBS_ERROR("Failed to write chunk " + std::to_string(id) + " to netCDF file: " + nc_strerror(retval));
+                }
+            }
+            m.unlock();
+        }
+        prg->increment((double)1 / (double)c->count_chunks());
+    };
+
+    p->apply(c, f);
+    nc_close(ncout);
+    prg->finalize();
+}
+
+template <typename T>
+void typed_export::write_tif_impl(std::shared_ptr<cube> c, std::string dir, std::string prefix, bool overviews,
+                                  bool cog, std::map<std::string, std::string> creation_options,
+                                  std::string rsmpl_overview, const packing *pk, std::shared_ptr<chunk_processor> p) {
+    if (!filesystem::exists(dir)) {
+        filesystem::mkdir_recursive(dir);
+    }
+    if (!filesystem::is_directory(dir)) {
+        throw std::string("ERROR in typed_export::write_tif(): invalid output directory.");
+    }
+
+    GDALDriver *gtiff_driver = (GDALDriver *)GDALGetDriverByName("GTiff");
+    if (gtiff_driver == NULL) {
+        throw std::string("ERROR in typed_export::write_tif(): cannot find GDAL driver for GTiff.");
+    }
+
+    std::shared_ptr<progress> prg = config::instance()->get_default_progress_bar()->get();
+    prg->set(0);
+
+    auto st = c->st_reference();
+    char **out_co = NULL;
+    for (auto it = creation_options.begin(); it != creation_options.end(); ++it) {
+        out_co = CSLAddNameValue(out_co, it->first.c_str(), it->second.c_str());
+    }
+    if (cog) {
+        // COG layout is produced by the final translate step, intermediate files are tiled and uncompressed
+        CSLDestroy(out_co);
+        out_co = NULL;
+        out_co = CSLAddNameValue(out_co, "TILED", "YES");
+    }
+
+    double affine[6] = {st->left(), st->dx(), 0.0, st->top(), 0.0, -st->dy()};
+    char *wkt = NULL;
+    st->srs_ogr().exportToWkt(&wkt);
+
+    std::vector<std::string> files(st->nt());
+    std::vector<GDALDataset *> datasets(st->nt(), nullptr);
+    for (uint32_t it = 0; it < st->nt(); ++it) {
+        files[it] = filesystem::join(dir, prefix + (st->t0() + st->dt() * it).to_string() + ".tif");
+        std::string fname = cog ? files[it] + ".tmp" : files[it];
+        datasets[it] = gtiff_driver->Create(fname.c_str(), st->nx(), st->ny(), c->bands().count(), gdal_type_of<T>(), out_co);
+        if (!datasets[it]) {
+            CSLDestroy(out_co);
+            CPLFree(wkt);
+            throw std::string("ERROR in typed_export::write_tif(): cannot create output file '" + fname + "'.");
+        }
+        datasets[it]->SetGeoTransform(affine);
+        datasets[it]->SetProjection(wkt);
+        for (uint16_t ib = 0; ib < c->bands().count(); ++ib) {
+            datasets[it]->GetRasterBand(ib + 1)->SetNoDataValue(pk ? pk->nodata_of(ib) : NAN);
+            double scale, offset;
+            stored_scale_offset(c->bands().get(ib), ib, pk, scale, offset);
+            if (scale != 1 || offset != 0) {
+                datasets[it]->GetRasterBand(ib + 1)->SetScale(scale);
+                datasets[it]->GetRasterBand(ib + 1)->SetOffset(offset);
+            }
+            datasets[it]->GetRasterBand(ib + 1)->SetDescription(c->bands().get(ib).name.c_str());
+        }
+    }
+    CSLDestroy(out_co);
+    CPLFree(wkt);
+
+    // time slices are finalized (overviews, COG layout) by separate threads as soon as their last chunk has been written
+    std::function<void(uint32_t)> finalize_slice = [&](uint32_t it) {
+        if (overviews) {
+            std::vector<int> levels;
+            int size_max = std::max(st->nx(), st->ny());
+            for (int l = 2; size_max / l >= 256; l *= 2) {
+                levels.push_back(l);
+            }
+            if (!levels.empty()) {
+                datasets[it]->BuildOverviews(rsmpl_overview.c_str(), levels.size(), levels.data(), 0, NULL, NULL, NULL);
+            }
+        }
+        if (cog) {
+            char **targs = NULL;
+            targs = CSLAddString(targs, "-of");
+            targs = CSLAddString(targs, "GTiff");
+            targs = CSLAddString(targs, "-co");
+            targs = CSLAddString(targs, "TILED=YES");
+            targs = CSLAddString(targs, "-co");
+            targs = CSLAddString(targs, "COPY_SRC_OVERVIEWS=YES");
+            for (auto it_co = creation_options.begin(); it_co != creation_options.end(); ++it_co) {
+                targs = CSLAddString(targs, "-co");
+                targs = CSLAddString(targs, (it_co->first + "=" + it_co->second).c_str());
+            }
+            GDALTranslateOptions *trans_options = GDALTranslateOptionsNew(targs, NULL);
+            if (trans_options == NULL) {
+                GCBS_ERROR("Cannot create gdal_translate options.");
+            } else {
+                GDALDatasetH out = GDALTranslate(files[it].c_str(), (GDALDatasetH)datasets[it], trans_options, NULL);
+                if (!out) {
+                    GCBS_ERROR("Cannot create cloud-optimized GeoTIFF '" + files[it] + "'.");
+                } else {
+                    GDALClose(out);
+                }
+                GDALTranslateOptionsFree(trans_options);
+            }
+            CSLDestroy(targs);
+            GDALClose((GDALDatasetH)datasets[it]);
+            std::remove((files[it] + ".tmp").c_str());
+        } else {
+            GDALClose((GDALDatasetH)datasets[it]);
+        }
+    };
+
+    std::mutex mq;
+    std::condition_variable cv;
+    std::deque<uint32_t> queue;
+    bool done = false;
+    std::vector<std::thread> finalizers;
+    auto start_finalizer = [&mq, &cv, &queue, &done, &finalize_slice, &finalizers]() {
+        finalizers.push_back(std::thread([&mq, &cv, &queue, &done, &finalize_slice]() {
+            while (true) {
+                std::unique_lock<std::mutex> lock(mq);
+                cv.wait(lock, [&queue, &done]() { return done || !queue.empty(); });
+                if (queue.empty()) return;
+                uint32_t it = queue.front();
+                queue.pop_front();
+                lock.unlock();
+                finalize_slice(it);
+            }
+        }));
+    };
+    // a single finalizer runs next to the chunk processor's workers, such that the configured number of threads is not exceeded much
+    start_finalizer();
+
+    // number of chunks per time chunk that have not been written yet
+    std::vector<uint32_t> remaining(c->count_chunks_t(), c->count_chunks_x() * c->count_chunks_y());
+    uint32_t nchunks_xy = c->count_chunks_x() * c->count_chunks_y();
+    uint32_t nt = st->nt();
+    uint32_t cs_t = c->chunk_size()[0];
+
+    std::function<void(chunkid_t, std::shared_ptr<chunk_data>, std::mutex &)> f = [c, &datasets, pk, prg, &remaining, nchunks_xy, nt, cs_t, &mq, &cv, &queue](chunkid_t id, std::shared_ptr<chunk_data> dat, std::mutex &m) {
+        std::shared_ptr<typed_chunk_data<T>> tdat;
+        bounds_nd<uint32_t, 3> lim = c->chunk_limits(id);
+        if (!dat->empty()) {
+            tdat = typed_chunk<T>(dat, pk);
+            dat.reset();
+        }
+        m.lock();
+        if (tdat) {
+            uint32_t csize_t = tdat->size()[1], csize_y = tdat->size()[2], csize_x = tdat->size()[3];
+            for (uint32_t it = 0; it < csize_t; ++it) {
+                for (uint16_t ib = 0; ib < tdat->size()[0]; ++ib) {
+                    T *ptr = tdat->buf() + (uint64_t(ib) * csize_t + it) * uint64_t(csize_y) * uint64_t(csize_x);
+                    CPLErr res = datasets[lim.low[0] + it]->GetRasterBand(ib + 1)->RasterIO(GF_Write, lim.low[2], lim.low[1], csize_x, csize_y, ptr, csize_x, csize_y, gdal_type_of<T>(), 0, 0, NULL);
+                    if (res != CE_None) {
+                        GCBS_WARN("RasterIO (write) failed for chunk " + std::to_string(id));
+                    }
+                }
+            }
+        }
+        uint32_t ct = id / nchunks_xy;
+        if (--remaining[ct] == 0) {
+            std::lock_guard<std::mutex> lock(mq);
+            for (uint32_t it = ct * cs_t; it < std::min(nt, (ct + 1) * cs_t); ++it) {
+                queue.push_back(it);
+            }
+            cv.notify_all();
+        }
+        m.unlock();
+        prg->increment((double)1 / (double)c->count_chunks());
+    };
+    // Slices of chunks that failed or were skipped after an interrupt are never queued by f, all datasets must be
+    // closed nevertheless. After apply(), the remaining slices are finalized with as many threads as the chunk processor.
+    auto finish = [&]() {
+        uint32_t nqueued = 0;
+        {
+            std::lock_guard<std::mutex> lock(mq);
+            for (uint32_t ct = 0; ct < remaining.size(); ++ct) {
+                if (remaining[ct] == 0) continue;
+                for (uint32_t it = ct * cs_t; it < std::min(nt, (ct + 1) * cs_t); ++it) {
+                    queue.push_back(it);
+                }
+            }
+            // includes completed slices that the running finalizer has not taken yet
+            nqueued = queue.size();
+        }
+        cv.notify_all();
+        for (uint32_t i = 1; i < std::min(nqueued, p->max_threads()); ++i) {
+            start_finalizer();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mq);
+            done = true;
+        }
+        cv.notify_all();
+        for (uint32_t i = 0; i < finalizers.size(); ++i) {
+            finalizers[i].join();
+        }
+    };
+    try {
+        p->apply(c, f);
+    } catch (...) {
+        finish();
+        throw;
+    }
+    finish();
+    prg->finalize();
+}
+
+template <typename T>
+void typed_export::write_zarr_impl(std::shared_ptr<cube> c, std::string path, uint8_t compression_level,
+                                   std::shared_ptr<chunk_processor> p) {
+    if (!filesystem::exists(path)) {
+        filesystem::mkdir_recursive(path);
+    }
+    if (!filesystem::is_directory(path)) {
+        throw std::string("ERROR in typed_export::write_zarr(): invalid output directory.");
+    }
+
+    std::shared_ptr<progress> prg = config::instance()->get_default_progress_bar()->get();
+    prg->set(0);
+
+    auto st = c->st_reference();
+    uint32_t nt = st->nt(), ny = st->ny(), nx = st->nx();
+    uint32_t chunksizes[] = {std::min(c->chunk_size()[0], nt), std::min(c->chunk_size()[1], ny), std::min(c->chunk_size()[2], nx)};
+
+    char *wkt = NULL;
+    std::string swkt = "";
+    if (st->srs_ogr().exportToWkt(&wkt) == OGRERR_NONE) {
+        swkt = wkt;
+        CPLFree(wkt);
+    }
+
+    nlohmann::json consolidated;
+    consolidated["zarr_consolidated_format"] = 1;
+    consolidated["metadata"][".zgroup"] = {{"zarr_format", 2}};
+    consolidated["metadata"][".zattrs"] = {{"crs_wkt", swkt},
+                                           {"GeoTransform", std::to_string(st->left()) + " " + std::to_string(st->dx()) + " 0 " +
+                                                                std::to_string(st->top()) + " 0 " + std::to_string(-st->dy())}};
+
+    // dimension variables, uncompressed with a single chunk each
+    std::vector<double> dim_t(nt), dim_y(ny), dim_x(nx);
+    for (uint32_t i = 0; i < nt; ++i) {
+        dim_t[i] = double(i) * st->dt().dt_interval;
+    }
+    for (uint32_t i = 0; i < ny; ++i) {
+        dim_y[i] = st->top() - (i + 0.5) * st->dy();
+    }
+    for (uint32_t i = 0; i < nx; ++i) {
+        dim_x[i] = st->left() + (i + 0.5) * st->dx();
+    }
+    std::vector<std::pair<std::string, std::vector<double> *>> dims = {{"time", &dim_t}, {"y", &dim_y}, {"x", &dim_x}};
+    for (uint16_t i = 0; i < dims.size(); ++i) {
+        std::string name = dims[i].first;
+        nlohmann::json zarray = {{"zarr_format", 2}, {"shape", {dims[i].second->size()}}, {"chunks", {dims[i].second->size()}}, {"dtype", "<f8"}, {"compressor", nullptr}, {"fill_value", "NaN"}, {"order", "C"}, {"filters", nullptr}};
+        nlohmann::json zattrs = {{"_ARRAY_DIMENSIONS", {name}}};
+        if (name == "time") {
+            zattrs["units"] = cf_time_unit(st->dt().dt_unit) + " since " + st->t0().to_string(datetime_unit::SECOND);
+            zattrs["calendar"] = "gregorian";
+            zattrs["standard_name"] = "time";
+        } else {
+            zattrs["standard_name"] = name == "y" ? "projection_y_coordinate" : "projection_x_coordinate";
+        }
+        consolidated["metadata"][name + "/.zarray"] = zarray;
+        consolidated["metadata"][name + "/.zattrs"] = zattrs;
+    }
+
+    for (uint16_t i = 0; i < c->bands().count(); ++i) {
+        band b = c->bands().get(i);
+        nlohmann::json zarray = {{"zarr_format", 2}, {"shape", {nt, ny, nx}}, {"chunks", {chunksizes[0], chunksizes[1], chunksizes[2]}}, {"dtype", zarr_dtype_of<T>()}, {"fill_value", "NaN"}, {"order", "C"}, {"filters", nullptr}};
+        if (compression_level > 0) {
+            zarray["compressor"] = {{"id", "zlib"}, {"level", compression_level}};
+        } else {
+            zarray["compressor"] = nullptr;
+        }
+        nlohmann::json zattrs = {{"_ARRAY_DIMENSIONS", {"time", "y", "x"}}};
+        if (!b.unit.empty()) {
+            zattrs["units"] = b.unit;
+        }
+        if (b.scale != 1 || b.offset != 0) {
+            zattrs["scale_factor"] = b.scale;
+            zattrs["add_offset"] = b.offset;
+        }
+        consolidated["metadata"][b.name + "/.zarray"] = zarray;
+        consolidated["metadata"][b.name + "/.zattrs"] = zattrs;
+    }
+
+    // write metadata of all arrays and dimension values before any chunk
+    for (auto it = consolidated["metadata"].begin(); it != consolidated["metadata"].end(); ++it) {
+        std::string key = it.key();
+        std::size_t pos = key.find('/');
+        if (pos != std::string::npos && !filesystem::exists(filesystem::join(path, key.substr(0, pos)))) {
+            filesystem::mkdir_recursive(filesystem::join(path, key.substr(0, pos)));
+        }
+        write_json(filesystem::join(path, key), it.value());
+    }
+    write_json(filesystem::join(path, ".zmetadata"), consolidated);
+    for (uint16_t i = 0; i < dims.size(); ++i) {
+        write_file(filesystem::join(filesystem::join(path, dims[i].first), "0"), dims[i].second->data(), dims[i].second->size() * sizeof(double));
+    }
+
+    std::vector<std::string> band_dirs;
+    for (uint16_t i = 0; i < c->bands().count(); ++i) {
+        band_dirs.push_back(filesystem::join(path, c->bands().get(i).name));
+    }
+
+    uint64_t nchunk = uint64_t(chunksizes[0]) * uint64_t(chunksizes[1]) * uint64_t(chunksizes[2]);
+    uint32_t nchunks_x = c->count_chunks_x(), nchunks_y = c->count_chunks_y();
+    std::function<void(chunkid_t, std::shared_ptr<chunk_data>, std::mutex &)> f = [c, &band_dirs, &chunksizes, nchunk, nchunks_x, nchunks_y, compression_level, prg](chunkid_t id, std::shared_ptr<chunk_data> dat, std::mutex &m) {
+        // missing chunk files are read as fill values, empty chunks are simply not written
+        if (!dat->empty()) {
+            std::shared_ptr<typed_chunk_data<T>> tdat = typed_chunk_data<T>::from(dat);
+            dat.reset();
+            uint32_t csize_t = tdat->size()[1], csize_y = tdat->size()[2], csize_x = tdat->size()[3];
+            uint64_t nband = uint64_t(csize_t) * uint64_t(csize_y) * uint64_t(csize_x);
+            std::string key = std::to_string(id / (nchunks_x * nchunks_y)) + "." + std::to_string((id / nchunks_x) % nchunks_y) + "." + std::to_string(id % nchunks_x);
+
+            // Zarr chunks always have the full chunk size, chunks at the boundary are padded with fill values
+            std::vector<T> full(nchunk);
+            std::vector<unsigned char> compressed;
+            for (uint16_t i = 0; i < tdat->size()[0]; ++i) {
+                std::fill(full.begin(), full.end(), std::numeric_limits<T>::quiet_NaN());
+                for (uint32_t it = 0; it < csize_t; ++it) {
+                    for (uint32_t iy = 0; iy < csize_y; ++iy) {
+                        const T *src = tdat->buf() + i * nband + (uint64_t(it) * csize_y + iy) * csize_x;
+                        std::copy(src, src + csize_x, full.data() + (uint64_t(it) * chunksizes[1] + iy) * chunksizes[2]);
+                    }
+                }
+                std::string fname = filesystem::join(band_dirs[i], key);
+                if (compression_level == 0) {
+                    write_file(fname, full.data(), nchunk * sizeof(T));
+                    continue;
+                }
+                uLongf len = compressBound(nchunk * sizeof(T));
+                compressed.resize(len);
+                if (compress2(compressed.data(), &len, (const Bytef *)full.data(), nchunk * sizeof(T), compression_level) != Z_OK) {
+                    throw std::string("ERROR in typed_export::write_zarr(): failed to compress chunk " + std::to_string(id));
+                }
+                write_file(fname, compressed.data(), len);
+            }
+        }
+        prg->increment((double)1 / (double)c->count_chunks());
+    };
+    p->apply(c, f);
+    prg->finalize();
+}
+
+}  // namespace gdalcubes
@@ -0,0 +1,143 @@
+
+#ifndef TYPED_EXPORT_H
+#define TYPED_EXPORT_H
+
+#include "typed_chunk.h"
+
+#include <map>
+
+namespace gdalcubes {
+
+/**
+ * @brief Export functions writing data cubes with a configurable element type
+ *
+ * In contrast to cube::write_netcdf_file() and cube::write_tif_collection(), values are converted
+ * to the target element type by the worker threads directly after reading a chunk, i.e., the writer only
+ * receives chunks of the target type.
+ */
+class typed_export {
+   public:
+    /**
+     * @brief Write a data cube as a single netCDF-4 file
+     *
+     * netCDF chunks are aligned with data cube chunks. If compiled with GDALCUBES_HDF5_DIRECT_CHUNK and compression is
+     * enabled, chunks are shuffled and deflated by the worker threads and written with HDF5 direct chunk writes.
+     *
+     * @param c data cube
+     * @param path output file
+     * @param type element type of band variables in the output file
+     * @param compression_level deflate level, 0 = no compression
+     * @param write_bounds write additional bounds variables for all dimensions
+     * @param p chunk processor, if nullptr, the default chunk processor will be used
+     */
+    static void write_netcdf(std::shared_ptr<cube> c, std::string path, element_type type,
+                             uint8_t compression_level = 0, bool write_bounds = true,
+                             std::shared_ptr<chunk_processor> p = nullptr);
+
+    /**
+     * @brief Write a data cube as a single netCDF-4 file with values packed to an integer type
+     *
+     * Values are packed by the worker threads, scale_factor, add_offset, and _FillValue attributes of band variables
+     * are set accordingly. If packing parameters are automatic, they are derived from the range of values with
+     * auto_packing() first.
+     *
+     * @param c data cube
+     * @param path output file
+     * @param type integer element type of band variables in the output file
+     * @param pk packing parameters
+     * @param compression_level deflate level, 0 = no compression
+     * @param write_bounds write additional bounds variables for all dimensions
+     * @param p chunk processor, if nullptr, the default chunk processor will be used
+     */
+    static void write_netcdf_packed(std::shared_ptr<cube> c, std::string path, element_type type, packing pk,
+                                    uint8_t compression_level = 0, bool write_bounds = true,
+                                    std::shared_ptr<chunk_processor> p = nullptr);
+
+    /**
+     * @brief Write time slices of a data cube as GeoTIFF files
+     *
+     * Overviews and cloud-optimized GeoTIFF layout of a time slice are created by separate finalizer threads
+     * as soon as all chunks of the slice have been written, i.e. while chunks of later slices are still being computed.
+     * One finalizer thread runs during chunk evaluation, slices that are still open afterwards (including slices of
+     * failed chunks) are finalized with the number of threads of the chunk processor.
+     *
+     * @param c data cube
+     * @param dir output directory
+     * @param prefix prefix of output filenames
+     * @param type element type of the output files
+     * @param overviews build overview images
+     * @param cog create cloud-optimized GeoTIFF files
+     * @param creation_options additional GDAL creation options
+     * @param rsmpl_overview resampling method for overviews
+     * @param p chunk processor, if nullptr, the default chunk processor will be used
+     */
+    static void write_tif(std::shared_ptr<cube> c, std::string dir, std::string prefix, element_type type,
+                          bool overviews = false, bool cog = false,
+                          std::map<std::string, std::string> creation_options = std::map<std::string, std::string>(),
+                          std::string rsmpl_overview = "nearest",
+                          std::shared_ptr<chunk_processor> p = nullptr);
+
+    /**
+     * @brief Write time slices of a data cube as GeoTIFF files with values packed to an integer type
+     *
+     * Parameters are identical to write_tif(), except that pk defines how values are packed to the integer element type.
+     * If packing parameters are automatic, they are derived from the range of values with auto_packing() first.
+     */
+    static void write_tif_packed(std::shared_ptr<cube> c, std::string dir, std::string prefix, element_type type,
+                                 packing pk, bool overviews = false, bool cog = false,
+                                 std::map<std::string, std::string> creation_options = std::map<std::string, std::string>(),
+                                 std::string rsmpl_overview = "nearest",
+                                 std::shared_ptr<chunk_processor> p = nullptr);
+
+    /**
+     * @brief Derive packing parameters from the range of values of a data cube
+     *
+     * The cube is evaluated only once: chunks are written to a temporary cube store in pk.tmpdir while the minimum and
+     * maximum of each band are computed. Afterwards, c is replaced by the cube store, such that the packed output
+     * can be written without evaluating the original cube again. Offset and scale are computed as in pack_minmax() of the
+     * R package, i.e. the minimum maps to the second lowest and the maximum to the highest value of the element type.
+     * The temporary cube store requires 8 bytes per cell on disk and must be deleted by the caller with cube_store_cube::remove(),
+     * also if this function fails.
+     *
+     * @param c data cube, replaced by the temporary cube store
+     * @param type integer element type
+     * @param pk packing parameters with tmpdir and optional nodata values
+     * @param p chunk processor
+     * @return packing parameters for all bands
+     */
+    static packing auto_packing(std::shared_ptr<cube> &c, element_type type, packing pk, std::shared_ptr<chunk_processor> p);
+
+    /**
+     * @brief Write a data cube as a Zarr (version 2) store on the local filesystem
+     *
+     * Every band is written as a Zarr array whose chunks are identical to the data cube chunks. Worker threads convert,
+     * compress, and write chunks as independent files without any shared lock. Metadata of all arrays is written
+     * before chunks and consolidated in a single .zmetadata file.
+     *
+     * @param c data cube
+     * @param path output directory
+     * @param type element type of band arrays
+     * @param compression_level zlib level, 0 = no compression
+     * @param p chunk processor, if nullptr, the default chunk processor will be used
+     */
+    static void write_zarr(std::shared_ptr<cube> c, std::string path, element_type type,
+                           uint8_t compression_level = 0, std::shared_ptr<chunk_processor> p = nullptr);
+
+   private:
+    template <typename T>
+    static void write_netcdf_impl(std::shared_ptr<cube> c, std::string path, uint8_t compression_level,
+                                  bool write_bounds, const packing *pk, std::shared_ptr<chunk_processor> p);
+
+    template <typename T>
+    static void write_tif_impl(std::shared_ptr<cube> c, std::string dir, std::string prefix, bool overviews,
+                               bool cog, std::map<std::string, std::string> creation_options,
+                               std::string rsmpl_overview, const packing *pk, std::shared_ptr<chunk_processor> p);
+
+    template <typename T>
+    static void write_zarr_impl(std::shared_ptr<cube> c, std::string path, uint8_t compression_level,
+                                std::shared_ptr<chunk_processor> p);
+};
+
+}  // namespace gdalcubes
+
+#endif  //TYPED_EXPORT_H
@@ -0,0 +1,150 @@
+
+#include "window_time_sliding.h"
+
+#include "kernels.h"
+
+#include <cstdlib>
+#include <map>
+
+namespace gdalcubes {
+
+window_time_sliding_cube::window_time_sliding_cube(std::shared_ptr<cube> in, std::vector<std::pair<std::string, std::string>> reducer_bands, uint16_t win_size_l, uint16_t win_size_r) : cube(std::make_shared<cube_st_reference>(*(in->st_reference()))), _in_cube(in), _reducer_bands(reducer_bands), _kernel(), _win_size_l(win_size_l), _win_size_r(win_size_r), _f_kernel(false) {
+    _chunk_size[0] = _in_cube->chunk_size()[0];
+    _chunk_size[1] = _in_cube->chunk_size()[1];
+    _chunk_size[2] = _in_cube->chunk_size()[2];
+
+    for (uint16_t i = 0; i < reducer_bands.size(); ++i) {
+        std::string reducerstr = std::get<0>(reducer_bands[i]);
+        std::string bandstr = std::get<1>(reducer_bands[i]);
+        if (!supports({reducer_bands[i]})) {
+            throw std::string("ERROR in window_time_sliding_cube::window_time_sliding_cube(): Unknown reducer given");
+        }
+        if (!in->bands().has(bandstr)) {
+            throw std::string("ERROR in window_time_sliding_cube::window_time_sliding_cube(): Input data cube has no band '" + bandstr + "'");
+        }
+        band b = in->bands().get(bandstr);
+        b.name = bandstr + "_" + reducerstr;
+        if (reducerstr == "count") {
+            b.scale = 1;
+            b.offset = 0;
+            b.unit = "";
+        }
+        _bands.add(b);
+    }
+}
+
+window_time_sliding_cube::window_time_sliding_cube(std::shared_ptr<cube> in, std::vector<double> kernel, uint16_t win_size_l, uint16_t win_size_r) : cube(std::make_shared<cube_st_reference>(*(in->st_reference()))), _in_cube(in), _reducer_bands(), _kernel(kernel), _win_size_l(win_size_l), _win_size_r(win_size_r), _f_kernel(true) {
+    _chunk_size[0] = _in_cube->chunk_size()[0];
+    _chunk_size[1] = _in_cube->chunk_size()[1];
+    _chunk_size[2] = _in_cube->chunk_size()[2];
+
+    if (kernel.size() != uint32_t(win_size_l) + uint32_t(win_size_r) + 1) {
+        throw std::string("ERROR in window_time_sliding_cube::window_time_sliding_cube(): Size of kernel does not match the window size");
+    }
+    for (uint16_t i = 0; i < in->bands().count(); ++i) {
+        _bands.add(in->bands().get(i));
+    }
+}
+
+std::shared_ptr<chunk_data> window_time_sliding_cube::read_chunk(chunkid_t id) {
+    GCBS_TRACE("window_time_sliding_cube::read_chunk(" + std::to_string(id) + ")");
+    std::shared_ptr<chunk_data> out = std::make_shared<chunk_data>();
+    if (id < 0 || id >= count_chunks())
+        return out;  // chunk is outside of the view, we don't need to read anything.
+
+    coords_nd<uint32_t, 3> size_tyx = chunk_size(id);
+    coords_nd<uint32_t, 4> size_btyx = {uint32_t(_bands.count()), size_tyx[0], size_tyx[1], size_tyx[2]};
+    uint64_t np = uint64_t(size_tyx[1]) * uint64_t(size_tyx[2]);
+
+    // time range of the input needed to compute all windows of this chunk
+    uint32_t nchunks_xy = count_chunks_x() * count_chunks_y();
+    int32_t nt = _in_cube->st_reference()->nt();
+    int32_t cs_t = _chunk_size[0];
+    int32_t t_first = (id / nchunks_xy) * cs_t;
+    int32_t t_lo = std::max(0, t_first - int32_t(_win_size_l));
+    int32_t t_hi = std::min(nt - 1, t_first + int32_t(size_tyx[0]) - 1 + int32_t(_win_size_r));
+    int32_t nt_buf = t_hi - t_lo + 1;
+
+    // input bands needed, each band is stored once as contiguous time series buffer with np values per time slice
+    std::map<uint16_t, std::vector<double>> series;
+    if (_f_kernel) {
+        for (uint16_t i = 0; i < _in_cube->bands().count(); ++i) {
+            series[i] = std::vector<double>();
+        }
+    } else {
+        for (uint16_t i = 0; i < _reducer_bands.size(); ++i) {
+            series[_in_cube->bands().get_index(_reducer_bands[i].second)] = std::vector<double>();
+        }
+    }
+    for (auto it = series.begin(); it != series.end(); ++it) {
+        it->second.resize(uint64_t(nt_buf) * np, NAN);
+    }
+
+    for (int32_t ct = t_lo / cs_t; ct <= t_hi / cs_t; ++ct) {
+        std::shared_ptr<chunk_data> x = _in_cube->read_chunk(ct * nchunks_xy + (id % nchunks_xy));
+        if (x->empty()) continue;
+        int32_t t_chunk = ct * cs_t;
+        for (auto it = series.begin(); it != series.end(); ++it) {
+            for (int32_t t = 0; t < int32_t(x->size()[1]); ++t) {
+                if (t_chunk + t < t_lo || t_chunk + t > t_hi) continue;
+                const double *src = ((double *)x->buf()) + (uint64_t(it->first) * x->size()[1] + t) * np;
+                std::copy(src, src + np, it->second.data() + uint64_t(t_chunk + t - t_lo) * np);
+            }
+        }
+    }
+
+    out->size(size_btyx);
+    out->buf(std::malloc(size_btyx[0] * size_btyx[1] * size_btyx[2] * size_btyx[3] * sizeof(double)));
+
+    int32_t tb = t_first - t_lo;
+    int32_t te = tb + size_tyx[0];
+    uint64_t nout = uint64_t(size_tyx[0]) * np;
+    if (_f_kernel) {
+        for (uint16_t i = 0; i < _bands.count(); ++i) {
+            double *o = ((double *)out->buf()) + i * nout;
+            kernels::window_kernel(series[i].data(), nt_buf, np, _kernel, _win_size_l, _win_size_r, tb, te, o);
+        }
+        return out;
+    }
+
+    std::vector<double> sum, count;
+    for (uint16_t i = 0; i < _reducer_bands.size(); ++i) {
+        std::string reducer = _reducer_bands[i].first;
+        const double *in = series[_in_cube->bands().get_index(_reducer_bands[i].second)].data();
+        double *o = ((double *)out->buf()) + i * nout;
+        if (reducer == "min") {
+            kernels::window_extremum<false>(in, nt_buf, np, _win_size_l, _win_size_r, tb, te, o);
+        } else if (reducer == "max") {
+            kernels::window_extremum<true>(in, nt_buf, np, _win_size_l, _win_size_r, tb, te, o);
+        } else {
+            sum.resize(nout);
+            count.resize(nout);
+            kernels::window_sum(in, nt_buf, np, _win_size_l, _win_size_r, tb, te, sum.data(), count.data());
+            for (uint64_t j = 0; j < nout; ++j) {
+                if (reducer == "count") {
+                    o[j] = count[j];
+                } else if (reducer == "mean") {
+                    o[j] = (count[j] > 0) ? sum[j] / count[j] : NAN;
+                } else {
+                    o[j] = (count[j] > 0) ? sum[j] : NAN;
+                }
+            }
+        }
+    }
+    return out;
+}
+
+void window_time_sliding_cube::register_cube_type() {
+    cube_factory::instance()->register_cube_type("window_time_sliding", [](nlohmann::json& j) {
+        std::shared_ptr<cube> in = cube_factory::instance()->create_from_json(j["in_cube"]);
+        uint16_t win_size_l = j["win_size_l"].get<uint16_t>();
+        uint16_t win_size_r = j["win_size_r"].get<uint16_t>();
+        if (j.count("kernel") > 0) {
+            return window_time_sliding_cube::create(in, j["kernel"].get<std::vector<double>>(), win_size_l, win_size_r);
+        }
+        std::vector<std::pair<std::string, std::string>> reducer_bands = j["reducer_bands"].get<std::vector<std::pair<std::string, std::string>>>();
+        return window_time_sliding_cube::create(in, reducer_bands, win_size_l, win_size_r);
+    });
+}
+
+}  // namespace gdalcubes
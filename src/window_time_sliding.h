@@ -0,0 +1,118 @@
+
+#ifndef WINDOW_TIME_SLIDING_H
+#define WINDOW_TIME_SLIDING_H
+
+#include "gdalcubes/src/gdalcubes.h"
+
+namespace gdalcubes {
+
+/**
+ * @brief A data cube that applies reducer functions or convolution kernels over moving windows along time
+ *
+ * In contrast to window_time_cube, windows are not recomputed from scratch for each time slice. Sums, means, and counts
+ * are updated with running sums, minima and maxima use monotonic queues, and wide kernels are applied in the frequency
+ * domain. The cost per time slice thus does not depend on the window size.
+ *
+ * Input chunks are read along the full time range needed for the windows of an output chunk, i.e.,
+ * chunks do not need to cover the full time axis.
+ */
+class window_time_sliding_cube : public cube {
+   public:
+    /**
+     * @brief Create a data cube that applies reducer functions over moving time windows
+     * @note This static creation method should preferably be used instead of the constructors as
+     * the constructors will not set connections between cubes properly.
+     * @param in input data cube
+     * @param reducer_bands vector of pairs (reducer, band name)
+     * @param win_size_l number of time slices before the current time slice
+     * @param win_size_r number of time slices after the current time slice
+     * @return a shared pointer to the created data cube instance
+     */
+    static std::shared_ptr<window_time_sliding_cube> create(std::shared_ptr<cube> in, std::vector<std::pair<std::string, std::string>> reducer_bands,
+                                                            uint16_t win_size_l, uint16_t win_size_r) {
+        std::shared_ptr<window_time_sliding_cube> out = std::make_shared<window_time_sliding_cube>(in, reducer_bands, win_size_l, win_size_r);
+        in->add_child_cube(out);
+        out->add_parent_cube(in);
+        return out;
+    }
+
+    /**
+     * @brief Create a data cube that applies a convolution kernel over moving time windows of all bands
+     * @note This static creation method should preferably be used instead of the constructors as
+     * the constructors will not set connections between cubes properly.
+     * @param in input data cube
+     * @param kernel kernel values, must have win_size_l + win_size_r + 1 elements
+     * @param win_size_l number of time slices before the current time slice
+     * @param win_size_r number of time slices after the current time slice
+     * @return a shared pointer to the created data cube instance
+     */
+    static std::shared_ptr<window_time_sliding_cube> create(std::shared_ptr<cube> in, std::vector<double> kernel,
+                                                            uint16_t win_size_l, uint16_t win_size_r) {
+        std::shared_ptr<window_time_sliding_cube> out = std::make_shared<window_time_sliding_cube>(in, kernel, win_size_l, win_size_r);
+        in->add_child_cube(out);
+        out->add_parent_cube(in);
+        return out;
+    }
+
+    /**
+     * @brief Check whether all reducers have a sliding window implementation ("sum", "mean", "count", "min", "max")
+     * @param reducer_bands vector of pairs (reducer, band name)
+     */
+    static bool supports(std::vector<std::pair<std::string, std::string>> reducer_bands) {
+        for (uint16_t i = 0; i < reducer_bands.size(); ++i) {
+            std::string r = reducer_bands[i].first;
+            if (r != "sum" && r != "mean" && r != "count" && r != "min" && r != "max") return false;
+        }
+        return true;
+    }
+
+   public:
+    window_time_sliding_cube(std::shared_ptr<cube> in, std::vector<std::pair<std::string, std::string>> reducer_bands, uint16_t win_size_l, uint16_t win_size_r);
+    window_time_sliding_cube(std::shared_ptr<cube> in, std::vector<double> kernel, uint16_t win_size_l, uint16_t win_size_r);
+
+   public:
+    ~window_time_sliding_cube() {}
+
+    std::shared_ptr<chunk_data> read_chunk(chunkid_t id) override;
+
+    nlohmann::json make_constructible_json() override {
+        nlohmann::json out;
+        out["cube_type"] = "window_time_sliding";
+        out["win_size_l"] = _win_size_l;
+        out["win_size_r"] = _win_size_r;
+        if (_f_kernel) {
+            out["kernel"] = _kernel;
+        } else {
+            out["reducer_bands"] = _reducer_bands;
+        }
+        out["in_cube"] = _in_cube->make_constructible_json();
+        return out;
+    }
+
+    /**
+     * @brief Register this cube type at the cube factory, such that it can be recreated from its JSON description
+     */
+    static void register_cube_type();
+
+   private:
+    std::shared_ptr<cube> _in_cube;
+    std::vector<std::pair<std::string, std::string>> _reducer_bands;
+    std::vector<double> _kernel;
+    uint16_t _win_size_l;
+    uint16_t _win_size_r;
+    bool _f_kernel;
+
+    void set_st_reference(std::shared_ptr<cube_st_reference> stref) override {
+        _st_ref->win() = stref->win();
+        _st_ref->srs() = stref->srs();
+        _st_ref->ny() = stref->ny();
+        _st_ref->nx() = stref->nx();
+        _st_ref->t0() = stref->t0();
+        _st_ref->t1() = stref->t1();
+        _st_ref->dt(stref->dt());
+    }
+};
+
+}  // namespace gdalcubes
+
+#endif  //WINDOW_TIME_SLIDING_H
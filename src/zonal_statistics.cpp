@@ -0,0 +1,262 @@
+
+#include "zonal_statistics.h"
+
+#include "incremental_reducer.h"
+#include "parallel_for.h"
+#include "parallel_reduce.h"
+
+#include <gdal_priv.h>
+#include <ogr_geometry.h>
+#include <ogr_spatialref.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <mutex>
+
+namespace gdalcubes {
+
+namespace {
+
+void add_ring(OGRLinearRing *ring, double left, double top, double dx, double dy, std::vector<std::array<double, 4>> &edges) {
+    if (ring == nullptr) return;
+    for (int i = 0; i + 1 < ring->getNumPoints(); ++i) {
+        std::array<double, 4> e = {(ring->getX(i) - left) / dx, (top - ring->getY(i)) / dy,
+                                   (ring->getX(i + 1) - left) / dx, (top - ring->getY(i + 1)) / dy};
+        if (e[1] != e[3]) edges.push_back(e);  // horizontal edges never cross pixel center rows
+    }
+}
+
+void add_geometry(OGRGeometry *g, double left, double top, double dx, double dy, std::vector<std::array<double, 4>> &edges) {
+    OGRwkbGeometryType type = wkbFlatten(g->getGeometryType());
+    if (type == wkbPolygon) {
+        OGRPolygon *poly = static_cast<OGRPolygon *>(g);
+        add_ring(poly->getExteriorRing(), left, top, dx, dy, edges);
+        for (int i = 0; i < poly->getNumInteriorRings(); ++i) {
+            add_ring(poly->getInteriorRing(i), left, top, dx, dy, edges);
+        }
+    } else if (type == wkbMultiPolygon || type == wkbGeometryCollection) {
+        OGRGeometryCollection *coll = static_cast<OGRGeometryCollection *>(g);
+        for (int i = 0; i < coll->getNumGeometries(); ++i) {
+            add_geometry(coll->getGeometryRef(i), left, top, dx, dy, edges);
+        }
+    } else {
+        throw std::string("ERROR in zonal_statistics::prepare(): Only polygon and multipolygon geometries are supported");
+    }
+}
+
+}  // namespace
+
+bool zonal_statistics::supports(std::string reducer) {
+    // which_min and which_max refer to positions along a reduced dimension, which does not exist here
+    return reducer != "which_min" && reducer != "which_max" && incremental_reducer::is_supported(reducer);
+}
+
+std::vector<zonal_statistics::polygon_edges> zonal_statistics::prepare(std::shared_ptr<cube> c, std::vector<std::string> &wkt, std::string srs) {
+    auto st = c->st_reference();
+
+    OGRSpatialReference srs_in;
+    srs_in.SetFromUserInput(srs.c_str());
+    OGRSpatialReference srs_out = st->srs_ogr();
+#if GDAL_VERSION_MAJOR >= 3
+    srs_in.SetAxisMappingStrategy(OAMS_TRADITIONAL_GIS_ORDER);
+    srs_out.SetAxisMappingStrategy(OAMS_TRADITIONAL_GIS_ORDER);
+#endif
+    OGRCoordinateTransformation *trans = nullptr;
+    if (!srs_in.IsSame(&srs_out)) {
+        trans = OGRCreateCoordinateTransformation(&srs_in, &srs_out);
+        if (trans == nullptr) {
+            throw std::string("ERROR in zonal_statistics::prepare(): Cannot transform polygons to the data cube's spatial reference system");
+        }
+    }
+
+    std::vector<polygon_edges> out(wkt.size());
+    for (uint32_t i = 0; i < wkt.size(); ++i) {
+        OGRGeometry *g = nullptr;
+        char *w = const_cast<char *>(wkt[i].c_str());
+        if (OGRGeometryFactory::createFromWkt(&w, nullptr, &g) != OGRERR_NONE || g == nullptr) {
+            if (trans) OCTDestroyCoordinateTransformation(trans);
+            throw std::string("ERROR in zonal_statistics::prepare(): Cannot parse WKT of polygon " + std::to_string(i + 1));
+        }
+        try {
+            if (trans) g->transform(trans);
+            add_geometry(g, st->left(), st->top(), st->dx(), st->dy(), out[i].edges);
+        } catch (std::string s) {
+            OGRGeometryFactory::destroyGeometry(g);
+            if (trans) OCTDestroyCoordinateTransformation(trans);
+            throw s;
+        }
+        OGRGeometryFactory::destroyGeometry(g);
+
+        out[i].col_min = out[i].row_min = std::numeric_limits<double>::max();
+        out[i].col_max = out[i].row_max = std::numeric_limits<double>::lowest();
+        for (uint32_t k = 0; k < out[i].edges.size(); ++k) {
+            const std::array<double, 4> &e = out[i].edges[k];
+            out[i].col_min = std::min(out[i].col_min, std::min(e[0], e[2]));
+            out[i].col_max = std::max(out[i].col_max, std::max(e[0], e[2]));
+            out[i].row_min = std::min(out[i].row_min, std::min(e[1], e[3]));
+            out[i].row_max = std::max(out[i].row_max, std::max(e[1], e[3]));
+        }
+    }
+    if (trans) OCTDestroyCoordinateTransformation(trans);
+    return out;
+}
+
+void zonal_statistics::row_spans(const std::vector<std::array<double, 4>> &edges, int32_t row, std::vector<std::pair<int32_t, int32_t>> &spans) {
+    spans.clear();
+    double yc = row + 0.5;
+    std::vector<double> xs;
+    for (uint32_t k = 0; k < edges.size(); ++k) {
+        const std::array<double, 4> &e = edges[k];
+        // half-open rule such that vertices on the center line are counted exactly once
+        if ((e[1] <= yc && yc < e[3]) || (e[3] <= yc && yc < e[1])) {
+            xs.push_back(e[0] + (yc - e[1]) * (e[2] - e[0]) / (e[3] - e[1]));
+        }
+    }
+    std::sort(xs.begin(), xs.end());
+    for (uint32_t k = 0; k + 1 < xs.size(); k += 2) {
+        // pixel i is inside if its center i + 0.5 is in [xs[k], xs[k + 1])
+        int32_t first = int32_t(std::ceil(xs[k] - 0.5));
+        int32_t last = int32_t(std::ceil(xs[k + 1] - 0.5));
+        if (last > first) spans.push_back(std::make_pair(first, last));
+    }
+}
+
+std::vector<std::vector<double>> zonal_statistics::compute(std::shared_ptr<cube> c, std::vector<std::string> wkt, std::string srs,
+                                                           std::vector<std::pair<std::string, std::string>> reducer_bands,
+                                                           uint32_t approx_quantile_compression) {
+    std::vector<uint16_t> band_idx;
+    for (uint16_t i = 0; i < reducer_bands.size(); ++i) {
+        if (!supports(reducer_bands[i].first)) {
+            throw std::string("ERROR in zonal_statistics::compute(): Unknown reducer '" + reducer_bands[i].first + "' given");
+        }
+        if (!c->bands().has(reducer_bands[i].second)) {
+            throw std::string("ERROR in zonal_statistics::compute(): Data cube has no band '" + reducer_bands[i].second + "'");
+        }
+        band_idx.push_back(c->bands().get_index(reducer_bands[i].second));
+    }
+
+    std::vector<polygon_edges> polygons = prepare(c, wkt, srs);
+    uint32_t npoly = polygons.size();
+    uint32_t nt = c->st_reference()->nt();
+
+    // find chunks that intersect with at least one polygon
+    std::vector<chunkid_t> chunks;
+    uint32_t nchunks_xy = c->count_chunks_x() * c->count_chunks_y();
+    for (uint32_t cxy = 0; cxy < nchunks_xy; ++cxy) {
+        double row0 = (cxy / c->count_chunks_x()) * c->chunk_size()[1];
+        double col0 = (cxy % c->count_chunks_x()) * c->chunk_size()[2];
+        double row1 = std::min(double(c->st_reference()->ny()), row0 + c->chunk_size()[1]);
+        double col1 = std::min(double(c->st_reference()->nx()), col0 + c->chunk_size()[2]);
+        bool intersects = false;
+        for (uint32_t ip = 0; ip < npoly && !intersects; ++ip) {
+            intersects = polygons[ip].col_min < col1 && polygons[ip].col_max > col0 &&
+                         polygons[ip].row_min < row1 && polygons[ip].row_max > row0;
+        }
+        if (!intersects) continue;
+        for (uint32_t ct = 0; ct < c->count_chunks_t(); ++ct) {
+            chunks.push_back(ct * nchunks_xy + cxy);
+        }
+    }
+
+    std::shared_ptr<progress> prg = config::instance()->get_default_progress_bar()->get();
+    prg->set(0);
+
+    auto init_states = [&reducer_bands, npoly, nt, approx_quantile_compression]() {
+        reducer_states s;
+        for (uint16_t i = 0; i < reducer_bands.size(); ++i) {
+            s.push_back(incremental_reducer::create(reducer_bands[i].first, approx_quantile_compression));
+            s.back()->init(uint64_t(npoly) * nt);
+        }
+        return s;
+    };
+    auto process_chunk = [c, &chunks, &polygons, &band_idx, &prg, nt](uint32_t k, reducer_states &s) {
+        chunkid_t id = chunks[k];
+        std::shared_ptr<chunk_data> dat = c->read_chunk(id);
+        prg->increment(1.0 / double(chunks.size()));
+        if (dat->empty()) return;
+
+        bounds_nd<uint32_t, 3> lim = c->chunk_limits(id);
+        int32_t csize_t = dat->size()[1], csize_y = dat->size()[2], csize_x = dat->size()[3];
+        int32_t row0 = lim.low[1], col0 = lim.low[2];
+
+        std::vector<std::array<double, 4>> edges;
+        std::vector<std::pair<int32_t, int32_t>> spans;
+        for (uint32_t ip = 0; ip < polygons.size(); ++ip) {
+            const polygon_edges &poly = polygons[ip];
+            if (poly.col_max <= col0 || poly.col_min >= col0 + csize_x || poly.row_max <= row0 || poly.row_min >= row0 + csize_y) continue;
+
+            // only keep edges that may cross center rows of this chunk
+            edges.clear();
+            for (uint32_t ie = 0; ie < poly.edges.size(); ++ie) {
+                const std::array<double, 4> &e = poly.edges[ie];
+                if (std::max(e[1], e[3]) >= row0 && std::min(e[1], e[3]) <= row0 + csize_y) edges.push_back(e);
+            }
+
+            int32_t r_first = std::max(row0, int32_t(std::floor(poly.row_min)));
+            int32_t r_last = std::min(row0 + csize_y, int32_t(std::ceil(poly.row_max)));
+            for (int32_t r = r_first; r < r_last; ++r) {
+                row_spans(edges, r, spans);
+                for (uint32_t is = 0; is < spans.size(); ++is) {
+                    int32_t first = std::max(col0, spans[is].first);
+                    int32_t last = std::min(col0 + csize_x, spans[is].second);
+                    if (last <= first) continue;
+                    for (uint16_t ir = 0; ir < s.size(); ++ir) {
+                        for (int32_t it = 0; it < csize_t; ++it) {
+                            const double *v = ((double *)dat->buf()) +
+                                              ((uint64_t(band_idx[ir]) * csize_t + it) * csize_y + (r - row0)) * csize_x + (first - col0);
+                            s[ir]->update_cell(uint64_t(ip) * nt + lim.low[0] + it, v, last - first, 0);
+                        }
+                    }
+                }
+            }
+        }
+    };
+
+    // Each set of states holds npoly * nt cells per reducer. Iterations take a free set from the pool and return it
+    // afterwards, i.e. there are never more sets than concurrently running threads of the chunk processor.
+    std::mutex m_pool;
+    std::vector<reducer_states> pool;
+    std::vector<reducer_states> all_states;
+    std::atomic<uint32_t> nprocessed(0);
+    parallel_for(chunks.size(), [&](uint32_t k) {
+        reducer_states s;
+        {
+            std::lock_guard<std::mutex> lock(m_pool);
+            if (pool.empty()) {
+                all_states.push_back(init_states());
+                pool.push_back(all_states.back());
+            }
+            s = pool.back();
+            pool.pop_back();
+        }
+        process_chunk(k, s);
+        {
+            std::lock_guard<std::mutex> lock(m_pool);
+            pool.push_back(s);
+        }
+        ++nprocessed;
+    });
+    prg->finalize();
+    if (nprocessed != chunks.size()) {
+        throw std::string("ERROR in zonal_statistics::compute(): computation has been interrupted");
+    }
+    pool.clear();
+
+    if (all_states.empty()) {
+        // no chunk intersects with any polygon
+        all_states.push_back(init_states());
+    }
+    std::vector<std::vector<double>> out(reducer_bands.size(), std::vector<double>(uint64_t(npoly) * nt));
+    for (uint16_t ir = 0; ir < reducer_bands.size(); ++ir) {
+        for (uint32_t is = 1; is < all_states.size(); ++is) {
+            all_states[0][ir]->merge(all_states[is][ir].get());
+            all_states[is][ir].reset();
+        }
+        all_states[0][ir]->finalize(out[ir].data());
+    }
+    return out;
+}
+
+}  // namespace gdalcubes
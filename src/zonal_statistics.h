@@ -0,0 +1,67 @@
+
+#ifndef ZONAL_STATISTICS_H
+#define ZONAL_STATISTICS_H
+
+#include "gdalcubes/src/gdalcubes.h"
+
+#include <array>
+
+namespace gdalcubes {
+
+/**
+ * @brief Summary statistics of data cube values over polygons, per polygon and time slice
+ *
+ * Polygons are rasterized chunk by chunk using the pixel center rule, i.e. a pixel belongs to a polygon if its center
+ * is inside the polygon. For each polygon and time slice, statistics are accumulated in the partial states of
+ * incremental reducers, which are updated from all chunks in parallel and merged afterwards. Chunks are processed by the
+ * default chunk processor, i.e. the computation can be interrupted, and there is at most one set of partial states per
+ * thread. Neither the cube nor
+ * a rasterized version of the polygons is ever held in memory completely; only chunks that intersect with at least one
+ * polygon are read.
+ */
+class zonal_statistics {
+   public:
+    /**
+     * @brief Compute zonal statistics
+     * @param c data cube
+     * @param wkt polygons or multipolygons as WKT strings
+     * @param srs spatial reference system of the polygons
+     * @param reducer_bands pairs of reducer and band names, reducers must be supported by supports()
+     * @param approx_quantile_compression compression parameter of approximate quantile reducers
+     * @return one vector per reducer / band pair with nt values for each polygon, i.e. time varies fastest
+     */
+    static std::vector<std::vector<double>> compute(std::shared_ptr<cube> c, std::vector<std::string> wkt, std::string srs,
+                                                    std::vector<std::pair<std::string, std::string>> reducer_bands,
+                                                    uint32_t approx_quantile_compression = 50);
+
+    /**
+     * @brief Check whether a reducer can be used in zonal statistics
+     */
+    static bool supports(std::string reducer);
+
+   protected:
+    /**
+     * @brief Polygon edges in continuous pixel coordinates of the cube (column / row)
+     */
+    struct polygon_edges {
+        double col_min, col_max, row_min, row_max;
+        std::vector<std::array<double, 4>> edges;  // col0, row0, col1, row1
+    };
+
+    /**
+     * @brief Parse polygons, transform them to the cube's spatial reference system and extract their edges
+     */
+    static std::vector<polygon_edges> prepare(std::shared_ptr<cube> c, std::vector<std::string> &wkt, std::string srs);
+
+    /**
+     * @brief Compute horizontal pixel spans [first, last) of a polygon in one row, using the even-odd rule
+     * @param edges edges of the polygon that may cross the row
+     * @param row row index
+     * @param spans output, pairs of first and last + 1 column index, not clipped
+     */
+    static void row_spans(const std::vector<std::array<double, 4>> &edges, int32_t row, std::vector<std::pair<int32_t, int32_t>> &spans);
+};
+
+}  // namespace gdalcubes
+
+#endif  //ZONAL_STATISTICS_H